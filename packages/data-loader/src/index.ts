@@ -1,2 +1,3 @@
 export * from './replay'
 export * from './from-sqlitedb'
+export * from './pack-records'
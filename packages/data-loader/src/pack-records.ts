@@ -0,0 +1,49 @@
+import { CardRecord } from '@ego/common'
+
+/**
+ * size of one packed record, see `Record' in engine-native/engine/record.h.
+ */
+export const PACKED_RECORD_SIZE = 56
+
+/**
+ * pack card records for `DataStore.addMany`.
+ */
+export function packRecords(records: CardRecord[]): Buffer {
+  const buffer = Buffer.alloc(records.length * PACKED_RECORD_SIZE)
+
+  records.forEach((r, i) => {
+    const off = i * PACKED_RECORD_SIZE
+    const [lo, hi] = splitSetcode(r.setcode)
+
+    buffer.writeUInt32LE(r.code, off + 0)
+    buffer.writeUInt32LE(r.alias, off + 4)
+    buffer.writeUInt32LE(lo, off + 8)
+    buffer.writeUInt32LE(hi, off + 12)
+    buffer.writeUInt32LE(r.type, off + 16)
+    buffer.writeUInt32LE(r.level, off + 20)
+    buffer.writeUInt32LE(r.attribute, off + 24)
+    buffer.writeUInt32LE(r.race, off + 28)
+    buffer.writeInt32LE(r.attack, off + 32)
+    buffer.writeInt32LE(r.defense, off + 36)
+    buffer.writeUInt32LE(r.lscale, off + 40)
+    buffer.writeUInt32LE(r.rscale, off + 44)
+    buffer.writeUInt32LE(r.link_marker, off + 48)
+  })
+
+  return buffer
+}
+
+// setcode is a decimal string of an uint64, too wide for a number.
+function splitSetcode(setcode: string): [number, number] {
+  const limbs = [0, 0, 0, 0] // 16 bits each, little endian.
+  for (const digit of setcode) {
+    let carry = digit.charCodeAt(0) - 48
+    for (let i = 0; i !== limbs.length; ++i) {
+      const v = limbs[i] * 10 + carry
+      limbs[i] = v & 0xFFFF
+      carry = v >>> 16
+    }
+  }
+
+  return [(limbs[0] | (limbs[1] << 16)) >>> 0, (limbs[2] | (limbs[3] << 16)) >>> 0]
+}
@@ -1,8 +1,8 @@
 import { CoreEngine } from '@ego/engine-interface'
-import { isQuestionMessage, LOCATION, Message, parseMessage, POS, Question } from '@ego/message-protocol'
+import { isQuestionMessage, LOCATION, Message, MESSAGE_FRAME_SIZE, MessageFrame, MSG, parseFramedMessage, POS, Question, readMessageFrames } from '@ego/message-protocol'
 import { prettyBuffer, dumpBuffer } from '@ego/common'
 import { HostMessage } from './message'
-import { replayInflate, replayStart } from './replay'
+import { replayInflate, replayStart, REPLAY_INFLATE_STOPS } from './replay'
 
 export interface DeckInfo {
   main: number[]
@@ -24,7 +24,8 @@ export class DuelDriver {
 
   constructor(readonly engine: CoreEngine, readonly options: DuelOptions) {
     this.state = createDuelState(engine, options)
-    this.state.inflate = replayInflate
+    this.state.inflate   = replayInflate
+    this.state.stopAfter = REPLAY_INFLATE_STOPS
   }
 
   start(): HostMessage[] {
@@ -51,27 +52,43 @@ function wrapError(fn: () => HostMessage[]): HostMessage[] {
   }
 }
 
+interface MessageBatch {
+  buffer: Buffer
+  frames: MessageFrame[]
+}
+
+// messages are only decoded when pulled, peekType() reads the index.
 class MessageQueue {
-  private queue: Message[] = []
+  private batch: MessageBatch = { buffer: Buffer.alloc(0), frames: [] }
   private index: number = 0
-  constructor(private pump: () => Message[]) { }
+  constructor(private pump: () => MessageBatch) { }
 
   pull(): Message {
-    return this.fill(), this.queue[this.index++]
+    return this.fill(), decode(this.batch, this.index++)
   }
 
-  peek(): Message {
-    return this.fill(), this.queue[this.index]
+  peekType(): number {
+    return this.fill(), this.batch.frames[this.index].type
   }
 
   private fill() {
-    while (this.index === this.queue.length) {
-      this.queue = this.pump()
+    while (this.index === this.batch.frames.length) {
+      this.batch = this.pump()
       this.index = 0
     }
   }
 }
 
+function decode(batch: MessageBatch, index: number): Message {
+  try {
+    return parseFramedMessage(batch.buffer, batch.frames[index])
+  } catch (error) {
+    console.error(`Error decoding message. buffer:`)
+    prettyBuffer(batch.buffer).forEach(line => console.error(line))
+    throw error
+  }
+}
+
 function createDuelState(engine: CoreEngine, options: DuelOptions): DuelState {
   const duel = engine.createDuel(options.seed)
 
@@ -85,20 +102,24 @@ function createDuelState(engine: CoreEngine, options: DuelOptions): DuelState {
 
   engine.startDuel(duel, options.engineOptions)
 
-  function pump() {
-    const [data] = engine.process(duel)
-    const buffer = Buffer.from(data)
-    try {
-      return parseMessage(buffer)
-    } catch (error) {
-      console.error(`Error pumping message. buffer:`)
-      prettyBuffer(buffer).forEach(line => console.error(line))
-      throw error
+  // where runUntilDecision leaves each batch, read in place. the engine
+  // only swaps them for bigger ones, fetched again once a batch is past
+  // what is held here.
+  let [messages, index] = engine.pendingBuffer(duel)
+
+  function pump(): MessageBatch {
+    // everything up to the next decision (or the next step the inflator
+    // queries the field after), one native call per batch.
+    const [length, , count] = engine.runUntilDecision(duel, state.stopAfter)
+    if (length > messages.byteLength || count * MESSAGE_FRAME_SIZE > index.byteLength) {
+      [messages, index] = engine.pendingBuffer(duel)
     }
+    return { buffer: Buffer.from(messages, 0, length), frames: readMessageFrames(index, count) }
   }
 
   const queue = new MessageQueue(pump)
-  return new DuelState(duel, engine, queue)
+  const state = new DuelState(duel, engine, queue)
+  return state
 }
 
 type MessageInflator = (engine: CoreEngine, duel: number, message: Message) => HostMessage[]
@@ -107,6 +128,8 @@ export class DuelState {
   lastQuestion?: Question
   finished: boolean = false
   inflate: MessageInflator
+  // message types `inflate' refreshes the field after.
+  stopAfter: number[] = []
 
   constructor(
     readonly duel: number,
@@ -118,7 +141,7 @@ export class DuelState {
     this.engine.setResponse(this.duel,
       response.buffer.slice(response.byteOffset, response.byteOffset + response.length))
 
-    if (this.queue.peek().msgtype === 'MSG_RETRY') {
+    if (this.queue.peekType() === MSG.RETRY) {
       console.warn(`last_question = ${JSON.stringify(this.lastQuestion, undefined, 4)}`)
       console.warn(`while response is:`)
       dumpBuffer(response)
@@ -1,5 +1,5 @@
-import { CoreEngine } from '@ego/engine-interface'
-import { isQuestionMessage, LOCATION, Message, MSG, parseMessage, Question } from '@ego/message-protocol'
+import { CoreEngine, RefreshQuery } from '@ego/engine-interface'
+import { isQuestionMessage, LOCATION, Message, MSG, parseMessage, Question, readMessageFrames } from '@ego/message-protocol'
 import { flatten, prettyBuffer } from '@ego/common'
 import { HostMessage } from './message'
 
@@ -18,6 +18,26 @@ export function replayStart(engine: CoreEngine, duel: number): HostMessage[] {
   return doReplayStart(engine, duel).map(wrap)
 }
 
+/**
+ * messages `replayInflate' queries the field after (questions aside, the
+ * native loop stops at those anyway). the field must be read as it is right
+ * after the step that emitted them, see `runUntilDecision'.
+ */
+export const REPLAY_INFLATE_STOPS = [
+  MSG.NEW_PHASE,
+  MSG.SUMMONED,
+  MSG.SPSUMMONED,
+  MSG.FLIPSUMMONED,
+  MSG.CHAINED,
+  MSG.CHAIN_SOLVED,
+  MSG.CHAIN_END,
+  MSG.DAMAGE_STEP_START,
+  MSG.REVERSE_DECK,
+  MSG.SHUFFLE_DECK,
+  MSG.SWAP_GRAVE_DECK,
+  MSG.MOVE
+]
+
 export function replayInflate(engine: CoreEngine, duel: number, message: Message): HostMessage[] {
   return isQuestionMessage(message)
     ? handleQuestion(engine, duel, message).map(wrap)
@@ -25,9 +45,9 @@ export function replayInflate(engine: CoreEngine, duel: number, message: Message
 }
 
 function doReplayStart(engine: CoreEngine, duel: number): Message[] {
-  return flatten([
-    refresh2(engine, duel, LOCATION.DECK, REFRESH_DECK_FLAGS),
-    refresh2(engine, duel, LOCATION.EXTRA, REFRESH_EXTRA_FLAGS)
+  return refresh(engine, duel, [
+    ...both(LOCATION.DECK, REFRESH_DECK_FLAGS),
+    ...both(LOCATION.EXTRA, REFRESH_EXTRA_FLAGS)
   ])
 }
 
@@ -91,38 +111,23 @@ function handleMessage(engine: CoreEngine, duel: number, m: Message): Message[]
   return flatten(messages)
 }
 
-interface RefreshParam {
-  player: number
-  location: number
-  flags: number
-}
-
-function prepend(header: number[], data: ArrayBuffer) {
-  return Buffer.concat([Buffer.from(header), Buffer.from(data)])
-}
-
-function doRefresh(engine: CoreEngine, duel: number, param: RefreshParam) {
-  const data = engine.queryFieldCard(duel, { ...param, cache: false })
-  const buffer = prepend([MSG.UPDATE_DATA, param.player, param.location], data)
-  try {
-    return parseMessage(buffer)
-  } catch (error) {
-    console.error(`error queryFieldCard:`)
-    prettyBuffer(buffer).forEach(line => console.error(line))
-    throw error
-  }
+function refresh(engine: CoreEngine, duel: number, queries: RefreshQuery[]): Message[] {
+  const [buffer, index] = engine.refreshBatch(duel, queries)
+  // MSG_UPDATE_DATA runs to the end of its buffer, parse each from its own slice.
+  return readMessageFrames(index).map(frame => {
+    const message = Buffer.from(buffer, frame.offset, frame.length)
+    try {
+      return parseMessage(message)[0]
+    } catch (error) {
+      console.error(`error refreshing:`)
+      prettyBuffer(message).forEach(line => console.error(line))
+      throw error
+    }
+  })
 }
 
-function doRefreshSingle(engine: CoreEngine, duel: number, param: RefreshParam & { sequence: number }) {
-  const data = engine.queryCard(duel, { ...param, cache: false })
-  const buffer = prepend([MSG.UPDATE_CARD, param.player, param.location, param.sequence], data)
-  try {
-    return parseMessage(buffer)
-  } catch (error) {
-    console.error(`error queryCard:`)
-    prettyBuffer(buffer).forEach(line => console.error(line))
-    throw error
-  }
+function both(location: number, flags: number, incremental: boolean = false): RefreshQuery[] {
+  return [{ player: 0, location, flags, incremental }, { player: 1, location, flags, incremental }]
 }
 
 function refreshSingle(
@@ -133,23 +138,22 @@ function refreshSingle(
   sequence: number,
   flags: number = REFRESH_SINGLE_FLAGS
 ) {
-  return doRefreshSingle(engine, duel, { player, location, sequence, flags })
+  return refresh(engine, duel, [{ player, location, sequence, flags }])
 }
 
 function refresh1(engine: CoreEngine, duel: number, player: number, location: number, flags: number = REFRESH_FLAGS) {
-  return doRefresh(engine, duel, { player, location, flags })
+  return refresh(engine, duel, [{ player, location, flags }])
 }
 
 function refresh2(engine: CoreEngine, duel: number, location: number, flags: number = REFRESH_FLAGS) {
-  return flatten([
-    doRefresh(engine, duel, { player: 0, location, flags }),
-    doRefresh(engine, duel, { player: 1, location, flags })])
+  return refresh(engine, duel, both(location, flags))
 }
 
+// only cards that changed since the last refresh of their slot are sent.
 function refreshReplay(engine: CoreEngine, duel: number, flags = REFRESH_FLAGS) {
-  return flatten([
-    refresh2(engine, duel, LOCATION.MZONE, flags),
-    refresh2(engine, duel, LOCATION.SZONE, flags),
-    refresh2(engine, duel, LOCATION.HAND, flags)
+  return refresh(engine, duel, [
+    ...both(LOCATION.MZONE, flags, true),
+    ...both(LOCATION.SZONE, flags, true),
+    ...both(LOCATION.HAND, flags, true)
   ])
 }
@@ -2,12 +2,144 @@ import { CardRecord } from '@ego/common'
 
 export interface DataStore {
   add(card: CardRecord): void
+  addMany(packed: ArrayBuffer | ArrayBufferView): number
   get(code: number): DataStore | undefined
   keys(): number []
+  freeze(): void
+  loadCdb(path: string): number
+  text(code: number): { name: string, description: string, texts: string[] } | undefined
+  saveSnapshot(path: string): void
+  loadSnapshot(path: string): number
 }
 
 export interface ScriptStore {
   add(filename: string, content: string): void
+  addCompiled(filename: string, bytecode: ArrayBuffer | ArrayBufferView): void
+  saveArchive(path: string): void
+  loadArchive(path: string): number
+  freeze(): void
+}
+
+export interface RefreshQuery {
+  player: number
+  location: number
+  flags: number
+  sequence?: number
+  cache?: boolean
+  incremental?: boolean
+}
+
+export type StepRequest = [number, (ArrayBuffer | ArrayBufferView)?]
+
+/**
+ * `[messages, entries, index]', see `readStepEntries'; `index' frames every
+ * message in `messages' (`readMessageFrames' in @ego/message-protocol).
+ */
+export type StepManyResult = [ArrayBuffer, ArrayBuffer, ArrayBuffer]
+
+/**
+ * a two player replay as `verifyReplays' takes it, `seed' is the one handed
+ * to ocgcore and `responses' are packed as in a .yrp (u8 length, bytes),
+ * or back to back and split by `offsets' (u32s, one more than there are
+ * responses).
+ */
+export interface ReplayInput {
+  seed: number
+  lp: number
+  start: number
+  draw: number
+  options: number
+  players: Array<{ main: number[], extra: number[] }>
+  responses: ArrayBuffer | ArrayBufferView
+  offsets?: ArrayBuffer | ArrayBufferView
+}
+
+/**
+ * a .yrp as `readReplay' decodes it, `time' is the seed as stored.
+ */
+export interface ReplayFile extends ReplayInput {
+  id: number
+  version: number
+  flag: number
+  time: number
+  hash: number
+  players: Array<{ name: string, main: number[], extra: number[] }>
+  responses: ArrayBuffer
+  offsets: ArrayBuffer
+}
+
+/**
+ * `[messages, index]' for player 0, player 1 and spectators, each with what
+ * that side must not see taken out (see `splitViews').
+ */
+export type MessageViews = [[ArrayBuffer, ArrayBuffer], [ArrayBuffer, ArrayBuffer], [ArrayBuffer, ArrayBuffer]]
+
+/**
+ * latencies in nanoseconds, percentiles to histogram precision (~6%).
+ */
+export interface LatencyStats {
+  count: number
+  mean: number
+  max: number
+  p50: number
+  p90: number
+  p99: number
+  p999: number
+}
+
+export interface EngineStats {
+  processCalls: number
+  messageBytes: number
+  cardHits: number
+  cardMisses: number
+  scriptHits: number
+  scriptMisses: number
+  queryCalls: number
+  process: LatencyStats
+  queryFieldCard: LatencyStats
+  setResponse: LatencyStats
+}
+
+/**
+ * what is kept of ocgcore's log output, per duel: one message in
+ * `sampleEvery', at most `burst' at once then `rate' a second (0 for no
+ * limit). defaults are 1, 64 and 32.
+ */
+export interface LogPolicy {
+  sampleEvery?: number
+  rate?: number
+  burst?: number
+}
+
+/**
+ * `type' as ocgcore has it, 1 for script errors, 2 for `Debug.Message'.
+ * `time' in milliseconds, steady clock.
+ */
+export interface LogMessage {
+  duel: number
+  type: number
+  time: number
+  text: string
+}
+
+/**
+ * `dropped': lost to a full ring (drain more often), `suppressed': left out
+ * by the policy.
+ */
+export interface LogBatch {
+  messages: LogMessage[]
+  dropped: number
+  suppressed: number
+}
+
+/**
+ * `capacity': spans kept per duel (the latest ones), 0 turns tracing off.
+ * `markers': also write them to ftrace's `trace_marker', for
+ * `perf record -e ftrace:print'.
+ */
+export interface TracingOptions {
+  capacity: number
+  markers?: boolean
 }
 
 export interface CoreEngine {
@@ -16,15 +148,116 @@ export interface CoreEngine {
   endDuel(duel: number): void
   setPlayerInfo(duel: number, info: { player: number, lp: number, start: number, draw: number }): void
   process(duel: number): [ArrayBuffer, number]
+  processAsync(duel: number): Promise<[number, number]>
+  runUntilDecision(duel: number, stopAfter?: number[]): [number, number, number]
+  indexMessages(messages: ArrayBuffer | ArrayBufferView): ArrayBuffer
+  splitViews(messages: ArrayBuffer | ArrayBufferView, index: ArrayBuffer | ArrayBufferView): MessageViews
+  stepMany(batch: StepRequest[], threads: number): StepManyResult
+  stepManyAsync(batch: StepRequest[], threads: number): Promise<StepManyResult>
   newCard(duel: number, card: { code: number, owner: number, player: number, location: number, sequence: number, position: number }): void
   queryCard(duel: number, query: { player: number, location: number, flags: number, sequence: number, cache: boolean }): ArrayBuffer
   queryFieldCount(duel: number, query: { player: number, location: number }): number
   queryFieldCard(duel: number, query: { player: number, location: number, flags: number, cache: boolean }): ArrayBuffer
   setResponse(duel: number, response: ArrayBuffer): void
+  messageBuffer(duel: number): ArrayBuffer
+  queryBuffer(duel: number): ArrayBuffer
+  processInto(duel: number): number
+  pendingBuffer(duel: number): [ArrayBuffer, ArrayBuffer]
+  queryCardInto(duel: number, query: { player: number, location: number, flags: number, sequence: number, cache: boolean }): number
+  queryFieldCardInto(duel: number, query: { player: number, location: number, flags: number, cache: boolean }): number
+  refreshBatch(duel: number, queries: RefreshQuery[]): [ArrayBuffer, ArrayBuffer]
+  snapshotDuel(duel: number): ArrayBuffer
+  restoreDuel(snapshot: ArrayBuffer | ArrayBufferView): [number, ArrayBuffer, ArrayBuffer]
+  forkDuel(duel: number): [number, ArrayBuffer, ArrayBuffer]
+  verifyReplays(replays: ReplayInput[], threads: number): ArrayBuffer
+  verifyReplaysAsync(replays: ReplayInput[], threads: number): Promise<ArrayBuffer>
+  stats(duel?: number): EngineStats
+  setLogPolicy(policy: LogPolicy): void
+  drainLog(duel?: number): LogBatch
+  setTracing(options: TracingOptions): void
+  exportTrace(duel?: number): string
   bindData(dataStore: DataStore): void
   bindScript(scriptStore: ScriptStore): void
 }
 
+/**
+ * what one duel of a `stepMany' batch emitted: `length' bytes of `messages'
+ * from `offset', framed by `frameCount' entries of the index from `firstFrame'
+ */
+export interface StepEntry {
+  duel: number
+  flags: number
+  offset: number
+  length: number
+  firstFrame: number
+  frameCount: number
+}
+
+const STEP_ENTRY_SIZE = 24
+
+export function readStepEntries(entries: ArrayBuffer): StepEntry[] {
+  const view = new Uint32Array(entries, 0, Math.floor(entries.byteLength / STEP_ENTRY_SIZE) * 6)
+  const result: StepEntry[] = []
+  for (let i = 0; i < view.length; i += 6) {
+    result.push({
+      duel: view[i],
+      flags: view[i + 1],
+      offset: view[i + 2],
+      length: view[i + 3],
+      firstFrame: view[i + 4],
+      frameCount: view[i + 5]
+    })
+  }
+  return result
+}
+
+export const REPLAY_OUTCOME = {
+  FINISHED: 0,
+  EXHAUSTED: 1,
+  RETRY: 2,
+  STALLED: 3,
+  MALFORMED: 4,
+  ENDED: 5
+}
+
+/**
+ * how one replay of a `verifyReplays' batch went: `consumed' of `total'
+ * responses were fed, `retryAt' is the response ocgcore rejected (outcome
+ * RETRY), `winner' and `reason' come from MSG_WIN (outcome FINISHED).
+ */
+export interface ReplayVerdict {
+  outcome: number
+  consumed: number
+  total: number
+  retryAt?: number
+  steps: number
+  winner?: number
+  reason?: number
+}
+
+const REPLAY_VERDICT_SIZE = 24
+
+export function readReplayVerdicts(verdicts: ArrayBuffer): ReplayVerdict[] {
+  const count = Math.floor(verdicts.byteLength / REPLAY_VERDICT_SIZE)
+  const words = new Uint32Array(verdicts, 0, count * 6)
+  const bytes = new Uint8Array(verdicts, 0, count * REPLAY_VERDICT_SIZE)
+  const result: ReplayVerdict[] = []
+  for (let i = 0; i < words.length; i += 6) {
+    const outcome = words[i]
+    const finished = outcome === REPLAY_OUTCOME.FINISHED
+    result.push({
+      outcome,
+      consumed: words[i + 1],
+      total: words[i + 2],
+      retryAt: outcome === REPLAY_OUTCOME.RETRY ? words[i + 3] : undefined,
+      steps: words[i + 4],
+      winner: finished ? bytes[i * 4 + 20] : undefined,
+      reason: finished ? bytes[i * 4 + 21] : undefined
+    })
+  }
+  return result
+}
+
 export class MonoEngine {
   constructor(
     public readonly core: CoreEngine,
@@ -0,0 +1,60 @@
+#include "fixtures.h"
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <memory>
+
+namespace ny {
+
+/**
+ * `process' / `queryCard' hand each result to js in a buffer of its own:
+ * allocated, filled, wrapped as an external ArrayBuffer and freed by its
+ * finalizer once collected. `Napi::ArrayBuffer::New' needs a running env,
+ * so only the native half of that round trip is measured here, against
+ * `processInto' / `queryCardInto' writing to the duel's own buffer.
+ */
+static
+void finalizer(void *, void *buffer)
+{
+  delete []static_cast<unsigned char *>(buffer);
+}
+
+static
+void BM_FreshBuffer(benchmark::State &state)
+{
+  auto const size   = std::size_t(state.range(0));
+  auto const source = std::vector<unsigned char>(size, 0x5A);
+
+  for (auto _: state) {
+    auto buffer = new unsigned char[size];
+    std::memcpy(buffer, source.data(), size);
+    benchmark::DoNotOptimize(buffer);
+    finalizer(nullptr, buffer);
+  }
+
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+static
+void BM_ReusedBuffer(benchmark::State &state)
+{
+  auto const size   = std::size_t(state.range(0));
+  auto const source = std::vector<unsigned char>(size, 0x5A);
+  auto const buffer = std::make_unique<unsigned char[]>(0x4000);
+
+  for (auto _: state) {
+    std::memcpy(buffer.get(), source.data(), size);
+    benchmark::DoNotOptimize(buffer.get());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+/**
+ * 64 bytes: a typical step, 0x1000: a full message buffer, 0x4000: a full
+ * query buffer.
+ */
+BENCHMARK(BM_FreshBuffer)->Arg(64)->Arg(0x1000)->Arg(0x4000);
+BENCHMARK(BM_ReusedBuffer)->Arg(64)->Arg(0x1000)->Arg(0x4000);
+
+} // namespace ny
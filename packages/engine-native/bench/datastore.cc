@@ -0,0 +1,65 @@
+#include "fixtures.h"
+#include <benchmark/benchmark.h>
+
+namespace ny {
+
+/**
+ * what ocgcore's card reader does per card, see `read_card_from_current_engine'.
+ */
+static
+void BM_CardIndexHit(benchmark::State &state)
+{
+  auto const &table = card_table();
+  auto        at    = std::size_t(0);
+
+  for (auto _: state) {
+    auto const record = table.index.find(table.codes[at]);
+    benchmark::DoNotOptimize(record);
+    at = at + 1 == table.codes.size() ? 0 : at + 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+static
+void BM_CardIndexMiss(benchmark::State &state)
+{
+  auto const &index = card_table().index;
+  auto const &codes = missing_codes();
+  auto        at    = std::size_t(0);
+
+  for (auto _: state) {
+    auto const record = index.find(codes[at]);
+    benchmark::DoNotOptimize(record);
+    at = at + 1 == codes.size() ? 0 : at + 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * hit, then the record copied out, as ocgcore gets it.
+ */
+static
+void BM_CardIndexRead(benchmark::State &state)
+{
+  auto const &table = card_table();
+  auto        at    = std::size_t(0);
+  auto        out   = Record();
+
+  for (auto _: state) {
+    if (auto const record = table.index.find(table.codes[at])) {
+      out = *record;
+    }
+    benchmark::DoNotOptimize(out);
+    at = at + 1 == table.codes.size() ? 0 : at + 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_CardIndexHit);
+BENCHMARK(BM_CardIndexMiss);
+BENCHMARK(BM_CardIndexRead);
+
+} // namespace ny
@@ -0,0 +1,258 @@
+#include "fixtures.h"
+#include "../engine/cdb.h"
+#include "../engine/messages.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <unordered_set>
+
+namespace ny {
+
+static constexpr std::uint32_t fixture_seed = 20191006;
+
+static
+void make_up_cards(CardIndex &index, std::mt19937 &random)
+{
+  auto code = std::uniform_int_distribution<std::uint32_t>(10000, 99999999);
+
+  while (index.size() != 12000) {
+    auto record = Record();
+    record.code  = code(random);
+    record.type  = 0x21;
+    record.level = 4;
+    index.insert(record);
+  }
+}
+
+CardTable const &card_table()
+{
+  static auto const table = [] {
+    auto table  = CardTable();
+    auto random = std::mt19937(fixture_seed);
+
+    if (auto const path = std::getenv("ENGINE_BENCH_CDB")) {
+      auto error = std::string();
+      if (load_cdb(path, table.index, error) < 0) {
+        std::fprintf(stderr, "enginebench: %s: %s\n", path, error.c_str());
+        std::exit(1);
+      }
+    } else {
+      make_up_cards(table.index, random);
+    }
+
+    table.index.freeze();
+    for (auto const &record: table.index) {
+      table.codes.push_back(record.code);
+    }
+    std::shuffle(table.codes.begin(), table.codes.end(), random);
+
+    return table;
+  }();
+
+  return table;
+}
+
+std::vector<std::uint32_t> const &missing_codes()
+{
+  static auto const codes = [] {
+    auto const &index  = card_table().index;
+    auto        random = std::mt19937(fixture_seed + 1);
+    auto        code   = std::uniform_int_distribution<std::uint32_t>(10000, 99999999);
+    auto        codes  = std::vector<std::uint32_t>();
+
+    while (codes.size() != 4096) {
+      auto const candidate = code(random);
+      if (!index.find(candidate)) {
+        codes.push_back(candidate);
+      }
+    }
+
+    return codes;
+  }();
+
+  return codes;
+}
+
+std::vector<std::string> const &script_names()
+{
+  static auto const names = [] {
+    static char const *prefixes[] = { "./script/"
+                                    , "script/"
+                                    , "./expansions/script/"
+                                    , "expansions/script/"
+                                    , "" };
+
+    auto random = std::mt19937(fixture_seed + 2);
+    auto names  = std::vector<std::string>();
+    auto seen   = std::unordered_set<std::uint32_t>();
+
+    for (auto const code: card_table().codes) {
+      if (names.size() == 10000) {
+        break;
+      }
+      if (seen.insert(code).second) {
+        auto const prefix = prefixes[random() % std::size(prefixes)];
+        names.push_back(std::string(prefix) + "c" + std::to_string(code) + ".lua");
+      }
+    }
+
+    /* what every duel loads first. */
+    names.push_back("./script/constant.lua");
+    names.push_back("./script/utility.lua");
+    std::shuffle(names.begin(), names.end(), random);
+
+    return names;
+  }();
+
+  return names;
+}
+
+namespace {
+
+/**
+ * messages of the given type with a zeroed body, lists get `n' items.
+ */
+struct StepWriter
+{
+  std::vector<unsigned char> bytes;
+
+  StepWriter &fixed(MessageType type, std::size_t body)
+  {
+    bytes.push_back(type);
+    bytes.insert(bytes.end(), body, 0);
+    return *this;
+  }
+
+  StepWriter &player(MessageType type, std::uint8_t player, std::size_t body)
+  {
+    bytes.push_back(type);
+    bytes.push_back(player);
+    bytes.insert(bytes.end(), body - 1, 0);
+    return *this;
+  }
+
+  /**
+   * a player, a u8 count, then `n' items of `size' bytes (MSG_DRAW, ...).
+   */
+  StepWriter &list(MessageType type, std::uint8_t player, std::uint8_t n, std::size_t size)
+  {
+    bytes.push_back(type);
+    bytes.push_back(player);
+    bytes.push_back(n);
+    bytes.insert(bytes.end(), n * size, 0);
+    return *this;
+  }
+
+  /**
+   * a player, then the six lists of MSG_SELECT_IDLECMD, `n' cards each.
+   */
+  StepWriter &idle(std::uint8_t player, std::uint8_t n)
+  {
+    bytes.push_back(MSG_SELECT_IDLECMD);
+    bytes.push_back(player);
+    for (int i = 0; i != 5; ++i) {
+      bytes.push_back(n);
+      bytes.insert(bytes.end(), n * 7, 0);
+    }
+    bytes.push_back(n);
+    bytes.insert(bytes.end(), n * 11, 0);
+    bytes.insert(bytes.end(), 3, 0);
+    return *this;
+  }
+};
+
+std::vector<std::vector<unsigned char>> make_up_steps()
+{
+  auto steps = std::vector<std::vector<unsigned char>>();
+
+  for (std::uint8_t turn = 0; turn != 40; ++turn) {
+    auto const player = std::uint8_t(turn & 1);
+
+    steps.push_back(StepWriter()
+                      .player(MSG_NEW_TURN, player, 1)
+                      .fixed(MSG_NEW_PHASE, 2)
+                      .list(MSG_DRAW, player, 1, 4)
+                      .bytes);
+
+    for (int chain = 0; chain != 3; ++chain) {
+      steps.push_back(StepWriter()
+                        .fixed(MSG_HINT, 6)
+                        .fixed(MSG_MOVE, 16)
+                        .fixed(MSG_CHAINING, 16)
+                        .fixed(MSG_CHAINED, 1)
+                        .bytes);
+      steps.push_back(StepWriter()
+                        .fixed(MSG_CHAIN_SOLVING, 1)
+                        .fixed(MSG_MOVE, 16)
+                        .fixed(MSG_MOVE, 16)
+                        .list(MSG_SHUFFLE_HAND, player, 5, 4)
+                        .fixed(MSG_CHAIN_SOLVED, 1)
+                        .fixed(MSG_CHAIN_END, 0)
+                        .bytes);
+    }
+
+    steps.push_back(StepWriter()
+                      .fixed(MSG_SUMMONING, 8)
+                      .fixed(MSG_MOVE, 16)
+                      .fixed(MSG_SUMMONED, 0)
+                      .fixed(MSG_DAMAGE, 5)
+                      .fixed(MSG_LPUPDATE, 5)
+                      .bytes);
+    steps.push_back(StepWriter()
+                      .fixed(MSG_WAITING, 0)
+                      .idle(player, 4)
+                      .bytes);
+  }
+
+  return steps;
+}
+
+std::vector<std::vector<unsigned char>> read_steps(char const *path)
+{
+  auto file  = std::ifstream(path, std::ios::binary);
+  if (!file) {
+    std::fprintf(stderr, "enginebench: %s: can not be read\n", path);
+    std::exit(1);
+  }
+
+  auto bytes = std::vector<unsigned char>( std::istreambuf_iterator<char>(file)
+                                         , std::istreambuf_iterator<char>());
+  auto steps = std::vector<std::vector<unsigned char>>();
+
+  for (std::size_t at = 0; at + 4 <= bytes.size(); ) {
+    auto const length = std::uint32_t(bytes[at])
+                      | std::uint32_t(bytes[at + 1]) << 8
+                      | std::uint32_t(bytes[at + 2]) << 16
+                      | std::uint32_t(bytes[at + 3]) << 24;
+    at += 4;
+    if (length > bytes.size() - at) {
+      break;
+    }
+    steps.emplace_back(bytes.begin() + at, bytes.begin() + at + length);
+    at += length;
+  }
+
+  if (steps.empty()) {
+    std::fprintf(stderr, "enginebench: %s: no steps recorded\n", path);
+    std::exit(1);
+  }
+
+  return steps;
+}
+
+} // namespace
+
+std::vector<std::vector<unsigned char>> const &recorded_steps()
+{
+  static auto const steps = [] {
+    auto const path = std::getenv("ENGINE_BENCH_MESSAGES");
+    return path ? read_steps(path) : make_up_steps();
+  }();
+
+  return steps;
+}
+
+} // namespace ny
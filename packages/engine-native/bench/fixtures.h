@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../engine/cardindex.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ny {
+
+/**
+ * what the benchmarks run on. each piece may be taken from a real file
+ * (see below), or is made up to look like one otherwise, always from the
+ * same seed so runs can be compared.
+ */
+
+struct CardTable
+{
+  CardIndex                  index;   // frozen
+  std::vector<std::uint32_t> codes;   // those in `index', shuffled
+};
+
+/**
+ * `ENGINE_BENCH_CDB': a cards.cdb, the whole `datas' table is loaded.
+ * made up: 12k cards with 8 digit codes.
+ */
+CardTable const &card_table();
+
+/**
+ * codes not in `card_table()'.
+ */
+std::vector<std::uint32_t> const &missing_codes();
+
+/**
+ * ~10k script names, spelled as ocgcore asks for them (`./script/c1234.lua',
+ * `script/c1234.lua', ...), shuffled.
+ */
+std::vector<std::string> const &script_names();
+
+/**
+ * `ENGINE_BENCH_MESSAGES': what `process' returned step after step, each
+ * step a u32 length (little endian) followed by that many bytes.
+ * made up: a few turns worth of draws, moves, chains and questions.
+ */
+std::vector<std::vector<unsigned char>> const &recorded_steps();
+
+} // namespace ny
@@ -0,0 +1,103 @@
+#include "fixtures.h"
+#include "../engine/messages.h"
+#include "../engine/visibility.h"
+#include <benchmark/benchmark.h>
+#include <cstring>
+
+namespace ny {
+
+/**
+ * the host side of `runUntilDecision' per step (`begin_step', `end_step'):
+ * what `get_message' wrote kept in the pending buffer, framed, and looked
+ * at for questions. ocgcore itself is left out, its output is replayed
+ * from `recorded_steps'.
+ */
+static
+void BM_MessagePump(benchmark::State &state)
+{
+  auto const &steps      = recorded_steps();
+  auto        pending    = std::vector<unsigned char>();
+  auto        frames     = std::vector<MessageFrame>();
+  auto const  stop_after = MessageTypeSet();
+  auto        bytes      = std::size_t(0);
+
+  for (auto _: state) {
+    pending.clear();
+    frames.clear();
+
+    for (auto const &step: steps) {
+      auto const offset = begin_step(pending, 0x1000);
+      std::memcpy(pending.data() + offset, step.data(), step.size());
+      benchmark::DoNotOptimize(end_step(pending, offset, step.size(), frames, stop_after));
+    }
+
+    bytes += pending.size();
+    benchmark::DoNotOptimize(frames.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * steps.size());
+  state.SetBytesProcessed(bytes);
+}
+
+namespace {
+
+struct FramedSteps
+{
+  std::vector<unsigned char> messages;
+  std::vector<MessageFrame>  frames;
+};
+
+FramedSteps const &framed_steps()
+{
+  static auto const framed = [] {
+    auto framed = FramedSteps();
+    for (auto const &step: recorded_steps()) {
+      auto const offset = framed.messages.size();
+      framed.messages.insert(framed.messages.end(), step.begin(), step.end());
+      frame_messages(step.data(), step.size(), offset, framed.frames);
+    }
+    return framed;
+  }();
+
+  return framed;
+}
+
+} // namespace
+
+static
+void BM_FrameMessages(benchmark::State &state)
+{
+  auto const &framed = framed_steps();
+  auto        frames = std::vector<MessageFrame>();
+
+  for (auto _: state) {
+    frames.clear();
+    frame_messages(framed.messages.data(), framed.messages.size(), 0, frames);
+    benchmark::DoNotOptimize(frames.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * framed.frames.size());
+  state.SetBytesProcessed(state.iterations() * framed.messages.size());
+}
+
+static
+void BM_SplitViews(benchmark::State &state)
+{
+  auto const &framed = framed_steps();
+  auto        views  = MessageViews();
+
+  for (auto _: state) {
+    views.clear();
+    split_views(framed.messages.data(), framed.frames.data(), framed.frames.size(), views);
+    benchmark::DoNotOptimize(views.messages[view_spectator].data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * framed.frames.size());
+  state.SetBytesProcessed(state.iterations() * framed.messages.size());
+}
+
+BENCHMARK(BM_MessagePump);
+BENCHMARK(BM_FrameMessages);
+BENCHMARK(BM_SplitViews);
+
+} // namespace ny
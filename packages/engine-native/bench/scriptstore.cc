@@ -0,0 +1,99 @@
+#include "fixtures.h"
+#include "../engine/scriptindex.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ny {
+
+namespace {
+
+/**
+ * `ScriptStore's index without the js side, `sources' keeps the bodies.
+ */
+struct ScriptTable
+{
+  std::vector<std::string> sources;
+  ScriptIndex              index;
+};
+
+ScriptTable const &script_table()
+{
+  static auto const table = [] {
+    auto table = std::make_unique<ScriptTable>();
+    auto const &names = script_names();
+
+    table->sources.reserve(names.size());
+    table->index.reserve(names.size());
+    for (auto const &name: names) {
+      table->sources.push_back("--" + name);
+      table->index.slot(name).source = table->sources.back();
+    }
+
+    return table;
+  }();
+
+  return *table;
+}
+
+} // namespace
+
+static
+void BM_ScriptBasename(benchmark::State &state)
+{
+  auto const &names = script_names();
+  auto        at    = std::size_t(0);
+
+  for (auto _: state) {
+    auto const basename = ScriptIndex::basename(names[at]);
+    benchmark::DoNotOptimize(basename);
+    at = at + 1 == names.size() ? 0 : at + 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+static
+void BM_ScriptFindHit(benchmark::State &state)
+{
+  auto const &table = script_table();
+  auto const &names = script_names();
+  auto        at    = std::size_t(0);
+
+  for (auto _: state) {
+    auto const script = table.index.find(names[at]);
+    benchmark::DoNotOptimize(script);
+    at = at + 1 == names.size() ? 0 : at + 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * ocgcore asks for scripts cards do not have (normal monsters, tokens).
+ */
+static
+void BM_ScriptFindMiss(benchmark::State &state)
+{
+  auto const &table = script_table();
+  auto        names = std::vector<std::string>();
+  for (auto const code: missing_codes()) {
+    names.push_back("./script/c" + std::to_string(code) + ".lua");
+  }
+  auto at = std::size_t(0);
+
+  for (auto _: state) {
+    auto const script = table.index.find(names[at]);
+    benchmark::DoNotOptimize(script);
+    at = at + 1 == names.size() ? 0 : at + 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ScriptBasename);
+BENCHMARK(BM_ScriptFindHit);
+BENCHMARK(BM_ScriptFindMiss);
+
+} // namespace ny
@@ -5,16 +5,76 @@
       "sources": [
         "engine/main.cc",
         "engine/datastore.cc",
+        "engine/cardindex.cc",
+        "engine/cdb.cc",
+        "engine/mappedfile.cc",
+        "engine/snapshot.cc",
         "engine/scriptstore.cc",
+        "engine/scriptarchive.cc",
+        "engine/messages.cc",
+        "engine/visibility.cc",
+        "engine/journal.cc",
+        "engine/replay.cc",
+        "engine/replayfile.cc",
+        "engine/stats.cc",
+        "engine/logring.cc",
+        "engine/trace.cc",
+        "engine/threadpool.cc",
         "engine/coreapi.cc"
       ],
+      "libraries": [
+        "-lsqlite3",
+        "-llzma"
+      ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
       ],
       "dependencies": [
         "<!(node -p \"require('node-addon-api').gyp\")"
       ],
+      "cflags_cc": ["-std=c++17"],
+      "xcode_settings": {
+        "CLANG_CXX_LANGUAGE_STANDARD": "c++17"
+      },
       "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS"]
     }
+  ],
+  "variables": {
+    "engine_bench%": "<!(node -p \"process.env.ENGINE_NATIVE_BENCH || 0\")"
+  },
+  "conditions": [
+    ["engine_bench==1", {
+      "targets": [
+        {
+          "target_name": "enginebench",
+          "type": "executable",
+          "sources": [
+            "bench/fixtures.cc",
+            "bench/datastore.cc",
+            "bench/scriptstore.cc",
+            "bench/messages.cc",
+            "bench/buffers.cc",
+            "engine/cardindex.cc",
+            "engine/cdb.cc",
+            "engine/messages.cc",
+            "engine/visibility.cc"
+          ],
+          "libraries": [
+            "-lbenchmark_main",
+            "-lbenchmark",
+            "-lsqlite3",
+            "-lpthread"
+          ],
+          "include_dirs": [
+            "<!@(node -p \"require('node-addon-api').include\")"
+          ],
+          "cflags_cc": ["-std=c++17"],
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17"
+          },
+          "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS"]
+        }
+      ]
+    }]
   ]
 }
@@ -0,0 +1,98 @@
+#include "cardindex.h"
+#include <algorithm>
+
+namespace ny {
+
+bool CardIndex::insert(Record const &record)
+{
+  if (frozen || find(record.code)) {
+    return false;
+  }
+
+  if ((owned_records.size() + 1) * 2 > owned_slots.size()) {
+    rebuild(std::max(owned_slots.size() * 2, min_slots));
+  }
+
+  owned_records.push_back(record);
+  records   = owned_records.data();
+  n_records = owned_records.size();
+
+  auto probe = bucket(record.code);
+  while (owned_slots[probe].index != empty_slot) {
+    probe = (probe + 1) & mask;
+  }
+  owned_slots[probe] = Slot { record.code, static_cast<std::uint32_t>(n_records - 1) };
+
+  return true;
+}
+
+void CardIndex::freeze()
+{
+  if (frozen) {
+    return;
+  }
+
+  std::sort( owned_records.begin()
+           , owned_records.end()
+           , [](Record const &lhs, Record const &rhs) { return lhs.code < rhs.code; });
+  owned_records.shrink_to_fit();
+  records   = owned_records.data();
+  n_records = owned_records.size();
+
+  std::size_t capacity = min_slots;
+  while (capacity < n_records * 2) {
+    capacity *= 2;
+  }
+  rebuild(capacity);
+
+  frozen = true;
+}
+
+void CardIndex::adopt( Record const          *records
+                     , std::size_t            n_records
+                     , Slot const            *slots
+                     , std::size_t            n_slots
+                     , std::shared_ptr<void>  storage)
+{
+  owned_records.clear();
+  owned_records.shrink_to_fit();
+  owned_slots.clear();
+  owned_slots.shrink_to_fit();
+
+  this->storage   = std::move(storage);
+  this->records   = records;
+  this->n_records = n_records;
+  this->slots     = slots;
+  set_capacity(n_slots);
+
+  frozen = true;
+}
+
+void CardIndex::rebuild(std::size_t capacity)
+{
+  owned_slots.assign(capacity, Slot { 0, empty_slot });
+  owned_slots.shrink_to_fit();
+  slots = owned_slots.data();
+  set_capacity(capacity);
+
+  for (std::uint32_t index = 0; index != n_records; ++index) {
+    auto probe = bucket(records[index].code);
+    while (owned_slots[probe].index != empty_slot) {
+      probe = (probe + 1) & mask;
+    }
+    owned_slots[probe] = Slot { records[index].code, index };
+  }
+}
+
+void CardIndex::set_capacity(std::size_t capacity)
+{
+  n_slots = capacity;
+  mask    = static_cast<std::uint32_t>(capacity - 1);
+  shift   = 32;
+  while (capacity > 1) {
+    capacity /= 2;
+    --shift;
+  }
+}
+
+} // namespace ny
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "record.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ny {
+
+/**
+ * flat card table keyed by code.
+ *
+ * records live in one contiguous array, looked up through an open
+ * addressing table of (code, index) pairs (linear probing, load <= 1/2),
+ * so a hit costs one probe line plus the record itself.
+ *
+ * `freeze' sorts the records by code, rebuilds the table to fit, and makes
+ * the index immutable (and thus safe to share between threads). a frozen
+ * layout can also be `adopt'ed from memory owned by someone else, e.g. a
+ * mapped snapshot.
+ */
+class CardIndex
+{
+public:
+  struct Slot
+  {
+    std::uint32_t code;
+    std::uint32_t index;
+  };
+
+  static constexpr std::uint32_t empty_slot = ~std::uint32_t(0);
+
+  /**
+   * fewest slots `insert' and `freeze' ever lay out.
+   */
+  static constexpr std::size_t min_slots = 64;
+
+private:
+  std::vector<Record>   owned_records;
+  std::vector<Slot>     owned_slots;
+  std::shared_ptr<void> storage;
+
+  Record const *records    = nullptr;
+  std::size_t   n_records  = 0;
+  Slot const   *slots      = nullptr;
+  std::size_t   n_slots    = 0;
+  std::uint32_t mask       = 0;
+  std::uint32_t shift      = 32;
+  bool          frozen     = false;
+
+public:
+  /**
+   * returns false if `code' is already there (or the index is frozen).
+   */
+  bool insert(Record const &record);
+
+  Record const *find(std::uint32_t code) const
+  {
+    if (!n_slots) {
+      return nullptr;
+    }
+
+    for (auto probe = bucket(code); ; probe = (probe + 1) & mask) {
+      auto const &slot = slots[probe];
+      if (slot.index == empty_slot) {
+        return nullptr;
+      }
+      if (slot.code == code) {
+        return &records[slot.index];
+      }
+    }
+  }
+
+  void freeze();
+
+  /**
+   * take over a frozen layout: `records' sorted by code, `slots' (a power
+   * of two of them) as built by `freeze'. `storage' keeps both alive.
+   */
+  void adopt( Record const          *records
+            , std::size_t            n_records
+            , Slot const            *slots
+            , std::size_t            n_slots
+            , std::shared_ptr<void>  storage);
+
+  bool is_frozen() const { return frozen; }
+
+  std::size_t size() const { return n_records; }
+
+  Record const *record_data() const { return records; }
+  Slot   const *slot_data()   const { return slots;   }
+  std::size_t   slot_count()  const { return n_slots; }
+
+  /**
+   * in code order once frozen, insertion order before that.
+   */
+  Record const *begin() const { return records;             }
+  Record const *end()   const { return records + n_records; }
+
+private:
+  /**
+   * fibonacci hashing, card codes are far from uniform in their low bits.
+   * shifted as 64 bits, a single slot table (`shift' 32) maps to 0.
+   */
+  std::uint32_t bucket(std::uint32_t code) const
+  {
+    return static_cast<std::uint32_t>(std::uint64_t(code * 0x9E3779B1u) >> shift);
+  }
+
+  void rebuild(std::size_t capacity);
+  void set_capacity(std::size_t capacity);
+};
+
+} // namespace ny
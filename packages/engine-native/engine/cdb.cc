@@ -0,0 +1,138 @@
+#include "cdb.h"
+#include <sqlite3.h>
+
+namespace ny {
+
+static constexpr std::uint32_t TYPE_LINK = 0x4000000;
+
+static
+Record make_record(sqlite3_stmt *row)
+{
+  Record record;
+
+  auto const level   = static_cast<std::uint32_t>(sqlite3_column_int64(row, 3));
+  auto const type    = static_cast<std::uint32_t>(sqlite3_column_int64(row, 2));
+  auto const defense = static_cast<std::int32_t>(sqlite3_column_int64(row, 7));
+
+  // see data-loader/src/from-sqlitedb.ts, mkRecord.
+  record.code        = static_cast<std::uint32_t>(sqlite3_column_int64(row, 0));
+  record.alias       = static_cast<std::uint32_t>(sqlite3_column_int64(row, 1));
+  record.setcode     = static_cast<std::uint64_t>(sqlite3_column_int64(row, 8));
+  record.type        = type;
+  record.level       = level & 0xFF;
+  record.attribute   = static_cast<std::uint32_t>(sqlite3_column_int64(row, 4));
+  record.race        = static_cast<std::uint32_t>(sqlite3_column_int64(row, 5));
+  record.attack      = static_cast<std::int32_t>(sqlite3_column_int64(row, 6));
+  record.defense     = (type & TYPE_LINK) ? 0 : defense;
+  record.lscale      = (level >> 24) & 0xFF;
+  record.rscale      = (level >> 16) & 0xFF;
+  record.link_marker = (type & TYPE_LINK) ? defense : 0;
+
+  return record;
+}
+
+long load_cdb(std::string const &path, CardIndex &index, std::string &error)
+{
+  sqlite3 *db = nullptr;
+  if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    error = db ? sqlite3_errmsg(db) : "out of memory";
+    sqlite3_close(db);
+    return -1;
+  }
+
+  char const *sql = "SELECT id, alias, type, level, attribute, race, atk, def, setcode FROM datas";
+
+  sqlite3_stmt *statement = nullptr;
+  if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    error = sqlite3_errmsg(db);
+    sqlite3_close(db);
+    return -1;
+  }
+
+  long added  = 0;
+  int  status = SQLITE_ROW;
+  while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+    added += index.insert(make_record(statement));
+  }
+
+  if (status != SQLITE_DONE) {
+    error = sqlite3_errmsg(db);
+    added = -1;
+  }
+
+  sqlite3_finalize(statement);
+  sqlite3_close(db);
+
+  return added;
+}
+
+CdbTexts::CdbTexts(std::string path)
+  : path(std::move(path))
+{ }
+
+CdbTexts::~CdbTexts()
+{
+  sqlite3_finalize(statement);
+  sqlite3_close(db);
+}
+
+bool CdbTexts::open()
+{
+  if (statement) {
+    return true;
+  }
+
+  if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    sqlite3_close(db);
+    db = nullptr;
+    return false;
+  }
+
+  char const *sql = "SELECT name, desc, str1, str2, str3, str4, str5, str6, str7, str8"
+                    "     , str9, str10, str11, str12, str13, str14, str15, str16"
+                    "  FROM texts WHERE id = ?";
+
+  if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    sqlite3_close(db);
+    db        = nullptr;
+    statement = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+static
+std::string column_text(sqlite3_stmt *row, int column)
+{
+  auto text = sqlite3_column_text(row, column);
+  return text ? reinterpret_cast<char const *>(text) : "";
+}
+
+bool CdbTexts::read(std::uint32_t code, CardText &text)
+{
+  if (!open()) {
+    return false;
+  }
+
+  sqlite3_reset(statement);
+  sqlite3_bind_int64(statement, 1, code);
+
+  if (sqlite3_step(statement) != SQLITE_ROW) {
+    return false;
+  }
+
+  text.name        = column_text(statement, 0);
+  text.description = column_text(statement, 1);
+  text.strings.clear();
+  for (int column = 2; column != 18; ++column) {
+    auto str = column_text(statement, column);
+    if (!str.empty()) {
+      text.strings.push_back(std::move(str));
+    }
+  }
+
+  return true;
+}
+
+} // namespace ny
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cardindex.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace ny {
+
+/**
+ * reads the `datas' table of a cards.cdb straight into `index'.
+ * returns the number of records added, or -1 (with `error' set).
+ */
+long load_cdb(std::string const &path, CardIndex &index, std::string &error);
+
+struct CardText
+{
+  std::string              name;
+  std::string              description;
+  std::vector<std::string> strings;
+};
+
+/**
+ * lazily opened view of the `texts' table.
+ */
+class CdbTexts
+{
+  std::string   path;
+  sqlite3      *db        = nullptr;
+  sqlite3_stmt *statement = nullptr;
+
+public:
+  explicit CdbTexts(std::string path);
+  ~CdbTexts();
+
+  CdbTexts(CdbTexts const &) = delete;
+  CdbTexts &operator =(CdbTexts const &) = delete;
+
+  /**
+   * false if the card has no text (or the database can not be read).
+   */
+  bool read(std::uint32_t code, CardText &text);
+
+private:
+  bool open();
+};
+
+} // namespace ny
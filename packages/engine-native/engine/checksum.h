@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ny {
+
+/**
+ * FNV-1a (64 bit), for the on-disk formats. not cryptographic.
+ */
+inline std::uint64_t checksum(void const *data, std::size_t length)
+{
+  auto bytes = static_cast<std::uint8_t const *>(data);
+  auto hash  = std::uint64_t(0xCBF29CE484222325ull);
+
+  for (std::size_t i = 0; i != length; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ull;
+  }
+
+  return hash;
+}
+
+} // namespace ny
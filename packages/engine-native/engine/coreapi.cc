@@ -1,8 +1,20 @@
 #include "coreapi.h"
 #include "datastore.h"
 #include "scriptstore.h"
+#include "messages.h"
+#include "journal.h"
+#include "replay.h"
+#include "visibility.h"
+#include "stats.h"
+#include "logring.h"
+#include "trace.h"
+#include "threadpool.h"
 #include "misc.h"
+#include <algorithm>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <vector>
 #include <uv.h>
 
 namespace ny {
@@ -19,15 +31,6 @@ void finalizer(void *, void *buffer)
   delete []static_cast<byte *>(buffer);
 }
 
-static
-uint32_t handle_ocgcore_message(void *pduel, uint32_t message_type)
-{
-  char const *str_buffer = static_cast<char const *>(pduel);
-  std::fprintf(stderr, "%u - %s\n", message_type, str_buffer);
-
-  return 0;
-}
-
 static
 byte *read_script_from_current_engine( char const *script_name
                                      , int        *script_length);
@@ -35,6 +38,9 @@ byte *read_script_from_current_engine( char const *script_name
 static
 std::uint32_t read_card_from_current_engine(std::uint32_t code, void *data);
 
+static
+std::uint32_t handle_message_from_current_duel(void *pduel, std::uint32_t message_type);
+
 bool initialize_core_api(CoreAPI *core_api, char const *path)
 {
   auto dylib_handler = new uv_lib_t;
@@ -82,7 +88,7 @@ bool initialize_core_api(CoreAPI *core_api, char const *path)
 
   core_api->set_script_reader(read_script_from_current_engine);
   core_api->set_card_reader(read_card_from_current_engine);
-  // core_api->set_message_handler(handle_ocgcore_message);
+  core_api->set_message_handler(handle_message_from_current_duel);
 
   return true;
 }
@@ -109,61 +115,110 @@ auto open_ocgcore(std::string const &path)
     : nullptr;
 }
 
-static /* thread_local ? */
-CoreEngine *g_current_engine = nullptr;
+/**
+ * thread local, `processAsync' runs ocgcore on the libuv thread pool, and
+ * every engine installs its own bindings before calling into ocgcore.
+ */
+static thread_local
+EngineContext const *t_current_context = nullptr;
+
+/**
+ * where card / script reads are counted, the duel being worked on if any,
+ * the engine's own stats otherwise.
+ */
+static thread_local
+Stats *t_current_stats = nullptr;
+
+/**
+ * where ocgcore's log messages go, the duel being worked on if any. those
+ * logged outside of a duel (while one is created, or by `verifyReplays')
+ * are not kept.
+ */
+static thread_local
+LogRing *t_current_log = nullptr;
+
+/**
+ * where card / script reads are traced, null unless the duel being worked
+ * on is traced (see `CoreEngine::setTracing').
+ */
+static thread_local
+TraceBuffer *t_current_trace = nullptr;
+
+class ContextScope
+{
+  EngineContext const *previous;
+  Stats               *previous_stats;
+  LogRing             *previous_log;
+  TraceBuffer         *previous_trace;
+
+public:
+  explicit ContextScope( EngineContext const &context
+                       , Stats               *stats = nullptr
+                       , LogRing             *log   = nullptr
+                       , TraceBuffer         *trace = nullptr)
+    : previous(t_current_context)
+    , previous_stats(t_current_stats)
+    , previous_log(t_current_log)
+    , previous_trace(t_current_trace)
+  {
+    t_current_context = &context;
+    t_current_stats   = stats ? stats : context.stats;
+    t_current_log     = log;
+    t_current_trace   = trace;
+  }
+
+  ~ContextScope()
+  {
+    t_current_context = previous;
+    t_current_stats   = previous_stats;
+    t_current_log     = previous_log;
+    t_current_trace   = previous_trace;
+  }
+
+  ContextScope(ContextScope const &) = delete;
+  ContextScope &operator =(ContextScope const &) = delete;
+};
 
 static
 std::uint32_t read_card_from_current_engine(std::uint32_t code, void *data)
 {
-  if (!g_current_engine) {
+  if (!t_current_context || !t_current_context->data_store) {
     TRACEF("read_card: current engine not set");
     return 1;
   }
 
-  auto data_store = g_current_engine->get_data_store();
-  auto found      = data_store->records().find(code);
-  if (found == data_store->records().end()) {
+  auto const span  = TraceSpan(t_current_trace, trace_card, code);
+  auto       found = t_current_context->data_store->records().find(code);
+  if (t_current_stats) {
+    t_current_stats->count(found ? stat_card_hits : stat_card_misses);
+  }
+  if (!found) {
     // TRACEF("read_card: card %u not found", code);
     return 1;
   }
-  *static_cast<Record *>(data) = found->second;
+  *static_cast<Record *>(data) = *found;
   return 0;
 }
 
-static
-byte *try_script( char const *script_name
-                , int        *script_length)
-{
-  auto script_store = g_current_engine->get_script_store();
-  auto found        = script_store->scripts().find(script_name);
-  if (found == script_store->scripts().end()) {
-    return nullptr;
-  }
-
-  *script_length = found->second.size();
-
-  return reinterpret_cast<byte *>(
-    const_cast<char *>(found->second.data()));
-}
-
 static
 byte *read_script_from_current_engine( char const *script_name
                                      , int        *script_length)
 {
-  if (!g_current_engine) {
+  if (!t_current_context || !t_current_context->script_store) {
     TRACEF("read_script: current engine not set");
     return nullptr;
   }
 
-  if (auto found = try_script(script_name, script_length)) {
-    return found;
+  auto const span  = TraceSpan(t_current_trace, trace_script, 0, script_name);
+  auto       found = t_current_context->script_store->scripts().find(script_name);
+  if (t_current_stats) {
+    t_current_stats->count(found ? stat_script_hits : stat_script_misses);
   }
 
-  for (char const *probe_script_name = script_name; *probe_script_name; ++probe_script_name) {
-    if (probe_script_name[0] != '/') continue;
-    if (auto found = try_script(probe_script_name + 1, script_length)) {
-      return found;
-    }
+  if (found) {
+    auto const script = found->preferred();
+    *script_length = script.size();
+    return reinterpret_cast<byte *>(const_cast<char *>(script.data()));
   }
 
   *script_length = 0;
@@ -172,46 +227,344 @@ byte *read_script_from_current_engine( char const *script_name
   return dummy_script_content;
 }
 
-#define switch_engine()      \
-  do {                       \
-    g_current_engine = this; \
-  } while (false)
+/**
+ * ocgcore calls this with its `strbuffer' filled in (`pduel' points at the
+ * duel, whose first member that is), see `LogPolicy' for what is kept.
+ */
+static
+std::uint32_t handle_message_from_current_duel(void *pduel, std::uint32_t message_type)
+{
+  if (t_current_log && t_current_context && pduel) {
+    t_current_log->push(t_current_context->log_policy, message_type, static_cast<char const *>(pduel));
+  }
+
+  return 0;
+}
 
-using duel_instance_id_t = std::uint32_t;
+#define switch_engine()                    \
+  auto const engine_context = context();   \
+  auto const context_scope  = ContextScope(engine_context)
+
+/**
+ * `switch_engine', with reads counted (and traced) against the duel at hand
+ * and log messages kept in its ring.
+ */
+#define switch_duel()                                                     \
+  auto const engine_context = context();                                  \
+  auto const context_scope  = ContextScope( engine_context                \
+                                          , instance->stats.get()         \
+                                          , instance->log.get()           \
+                                          , instance->trace.get())
 
 DataStore   const *CoreEngine::get_data_store()   const { return data_store;   }
 ScriptStore const *CoreEngine::get_script_store() const { return script_store; }
 
+EngineContext CoreEngine::context() const
+{
+  return EngineContext { data_store, script_store, engine_stats.get(), log_policy };
+}
+
+/**
+ * see `CoreEngine::create_duel'.
+ */
+static std::mutex duel_set_mutex;
+
+duel_ptr_t CoreEngine::create_duel(std::uint32_t seed)
+{
+  auto const lock = std::lock_guard<std::mutex>(duel_set_mutex);
+  return api->create_duel(seed);
+}
+
+void CoreEngine::end_duel(duel_ptr_t duel)
+{
+  auto const lock = std::lock_guard<std::mutex>(duel_set_mutex);
+  api->end_duel(duel);
+}
+
+bool CoreEngine::require_frozen_stores(Napi::Env env) const
+{
+  if ((data_store && !data_store->records().is_frozen()) || (script_store && !script_store->is_frozen())) {
+    Napi::Error::New(env, "Error: freeze the bound DataStore and ScriptStore first").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  return true;
+}
+
+void CoreEngine::hold_for_worker()
+{
+  Ref();
+  ++running_workers;
+}
+
+void CoreEngine::release_from_worker()
+{
+  --running_workers;
+  Unref();
+}
+
+static constexpr std::size_t message_buffer_size = 0x1000;
+static constexpr std::size_t query_buffer_size   = 0x4000;
+
+/**
+ * `runUntilDecision' hands back what it has once this much is pending, even
+ * if no decision was asked for yet.
+ */
+static constexpr std::size_t decision_buffer_limit = 0x100000;
+
+/**
+ * per duel side data.
+ */
+struct DuelInstance
+{
+  duel_ptr_t duel = 0;
+
+  /**
+   * a duel is busy while a `processAsync' step owns it, no other call may
+   * touch it until the step settles.
+   */
+  bool       busy = false;
+
+  /**
+   * reusable message / query buffers, handed to js once as external
+   * ArrayBuffers. they are freed by their finalizers (not by `endDuel'),
+   * so js never sees a dangling buffer.
+   */
+  byte                              *message_buffer = nullptr;
+  byte                              *query_buffer   = nullptr;
+  Napi::Reference<Napi::ArrayBuffer> message_buffer_ref;
+  Napi::Reference<Napi::ArrayBuffer> query_buffer_ref;
+
+  /**
+   * scratch for `runUntilDecision', kept to reuse its capacity.
+   */
+  std::vector<byte>                  pending;
+  std::vector<MessageFrame>          frames;
+
+  /**
+   * `pending' and `frames' as js reads them, see `pendingBuffer'. external
+   * ArrayBuffers like `message_buffer', replaced only when a batch
+   * outgrows them.
+   */
+  byte                              *pending_buffer   = nullptr;
+  std::size_t                        pending_capacity = 0;
+  Napi::Reference<Napi::ArrayBuffer> pending_buffer_ref;
+  byte                              *frame_buffer     = nullptr;
+  std::size_t                        frame_capacity   = 0;
+  Napi::Reference<Napi::ArrayBuffer> frame_buffer_ref;
+
+  /**
+   * type and recipient of the last question `runUntilDecision' ran into,
+   * 0 if none yet.
+   */
+  std::uint8_t                       last_question           = 0;
+  std::uint8_t                       last_question_recipient = recipient_all;
+
+  /**
+   * scratch for `refreshBatch'.
+   */
+  std::vector<byte>                  refresh;
+  std::vector<MessageFrame>          refresh_frames;
+
+  /**
+   * last query chunk seen per card slot, see `slot_key' and `diff_chunks'.
+   */
+  std::map<std::uint32_t, std::vector<byte>> last_chunks;
+
+  /**
+   * how the duel got where it is, see `snapshotDuel'.
+   */
+  DuelJournal                                journal;
+
+  /**
+   * see `CoreEngine::stats', boxed as it is not movable.
+   */
+  std::unique_ptr<Stats>                     stats = std::make_unique<Stats>();
+
+  /**
+   * see `CoreEngine::drainLog', boxed as it is not movable.
+   */
+  std::unique_ptr<LogRing>                   log   = std::make_unique<LogRing>();
+
+  /**
+   * null unless traced, see `CoreEngine::setTracing'.
+   */
+  std::unique_ptr<TraceBuffer>               trace;
+};
+
+static
+std::uint32_t slot_key(std::uint32_t player, std::uint32_t location, std::uint32_t sequence)
+{
+  return (player & 0xFF) << 24 | (location & 0xFFFF) << 8 | (sequence & 0xFF);
+}
+
+/**
+ * walks the chunks of a query result (`[u32 length][...]', one per card),
+ * remembers each under its slot, and if `incremental' swaps those equal to
+ * what was remembered before for an empty chunk (just the length, 4),
+ * which clients skip. works in place, returns the new length.
+ *
+ * `changed' tells if any chunk differed. a field query (`sequence' < 0)
+ * also forgets slots past its last chunk, a card showing up there later is
+ * always sent.
+ */
+static
+std::size_t diff_chunks( std::map<std::uint32_t, std::vector<byte>> &last_chunks
+                       , byte                                       *chunks
+                       , std::size_t                                 length
+                       , std::uint32_t                               player
+                       , std::uint32_t                               location
+                       , std::int32_t                                sequence
+                       , bool                                        incremental
+                       , bool                                       &changed)
+{
+  static constexpr std::uint32_t empty_chunk = 4;
+
+  auto read    = chunks;
+  auto write   = chunks;
+  auto end     = chunks + length;
+  auto current = sequence < 0 ? 0u : std::uint32_t(sequence);
+
+  changed = false;
+
+  for (; end - read >= 4; ++current) {
+    std::uint32_t chunk_length;
+    std::memcpy(&chunk_length, read, sizeof chunk_length);
+    if (chunk_length < 4 || chunk_length > std::size_t(end - read)) {
+      chunk_length = end - read;
+    }
+
+    auto &last = last_chunks[slot_key(player, location, current)];
+    auto const same = last.size() == chunk_length
+                   && std::memcmp(last.data(), read, chunk_length) == 0;
+
+    if (!same) {
+      changed = true;
+      last.assign(read, read + chunk_length);
+    }
+
+    if (same && incremental) {
+      std::memcpy(write, &empty_chunk, sizeof empty_chunk);
+      write += sizeof empty_chunk;
+    } else {
+      std::memmove(write, read, chunk_length);
+      write += chunk_length;
+    }
+    read += chunk_length;
+  }
+
+  if (sequence < 0) {
+    last_chunks.erase( last_chunks.lower_bound(slot_key(player, location, current))
+                     , last_chunks.upper_bound(slot_key(player, location, 0xFF)));
+  }
+
+  return write - chunks;
+}
+
+/**
+ * generational slot map. a duel id is `generation << 16 | index', looking
+ * one up is an index check plus a generation compare, and ids of ended
+ * duels stay invalid once their slot is reused.
+ *
+ * slots live in a deque, so a `DuelInstance *' stays put while other duels
+ * come and go (async workers hold on to theirs).
+ */
 struct CoreEngine::Wrapper
 {
-  std::map<duel_instance_id_t, duel_ptr_t> duel_ptr_by_id;
-  duel_instance_id_t                       last_id;
+  static constexpr std::uint32_t index_bits = 16;
+  static constexpr std::uint32_t index_mask = (1u << index_bits) - 1;
 
-  duel_instance_id_t acquire(duel_ptr_t duel)
+  struct Slot
+  {
+    /**
+     * bumped whenever the slot is released, never 0, so id 0 is never valid.
+     */
+    std::uint32_t generation = 1;
+    bool          live       = false;
+    DuelInstance  instance;
+  };
+
+  std::deque<Slot>           slots;
+  std::vector<std::uint32_t> free_slots;
+
+  /**
+   * returns 0 if all slots are taken.
+   */
+  duel_instance_id_t acquire(Napi::Env env, duel_ptr_t duel, std::size_t trace_capacity)
   {
-    auto id = ++last_id;
-    duel_ptr_by_id.insert({ id, duel });
-    return id;
+    std::uint32_t index;
+    if (!free_slots.empty()) {
+      index = free_slots.back();
+      free_slots.pop_back();
+    } else if (slots.size() <= index_mask) {
+      index = slots.size();
+      slots.emplace_back();
+    } else {
+      return 0;
+    }
+
+    auto &slot     = slots[index];
+    auto &instance = slot.instance;
+
+    instance.duel           = duel;
+    instance.message_buffer = new byte[message_buffer_size];
+    instance.query_buffer   = new byte[query_buffer_size];
+
+    instance.message_buffer_ref = Napi::Persistent(
+      Napi::ArrayBuffer::New(env, instance.message_buffer, message_buffer_size, finalizer));
+    instance.query_buffer_ref   = Napi::Persistent(
+      Napi::ArrayBuffer::New(env, instance.query_buffer, query_buffer_size, finalizer));
+
+    if (trace_capacity) {
+      instance.trace = std::make_unique<TraceBuffer>(trace_capacity);
+    }
+
+    slot.live = true;
+    return slot.generation << index_bits | index;
   }
 
-  duel_ptr_t lookup(duel_instance_id_t id) const
+  DuelInstance *find(duel_instance_id_t id)
   {
-    auto found = duel_ptr_by_id.find(id);
-    if (found == duel_ptr_by_id.end()) {
-      return 0;
+    auto const index = id & index_mask;
+    if (index >= slots.size()) {
+      return nullptr;
     }
-    return found->second;
+
+    auto &slot = slots[index];
+    return slot.live && slot.generation == id >> index_bits ? &slot.instance : nullptr;
   }
 
   void release(duel_instance_id_t id)
   {
-    duel_ptr_by_id.erase(id);
+    if (!find(id)) {
+      return;
+    }
+
+    auto const index = id & index_mask;
+    auto      &slot  = slots[index];
+
+    slot.instance = DuelInstance();
+    slot.live     = false;
+    slot.generation = (slot.generation + 1) & (0xFFFFFFFFu >> index_bits);
+    if (slot.generation == 0) {
+      slot.generation = 1;
+    }
+    free_slots.push_back(index);
+  }
+
+  void set_busy(duel_instance_id_t id, bool is_busy)
+  {
+    if (auto instance = find(id)) {
+      instance->busy = is_busy;
+    }
   }
 };
 
 CoreEngine::CoreEngine(Napi::CallbackInfo const &info)
   : Napi::ObjectWrap<CoreEngine>(info)
   , wrapper(std::make_unique<CoreEngine::Wrapper>())
+  , engine_stats(std::make_unique<Stats>())
+  , retired_stats(std::make_unique<StatsTotals>())
 {
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
@@ -232,7 +585,13 @@ Napi::Value CoreEngine::bindData(Napi::CallbackInfo const &info)
   REQUIRE_N_ARGS(info, 1);
   GET_ARG_OF_TYPE(info, 0, Object);
 
-  data_store = DataStore::Unwrap(arg0);
+  if (running_workers) {
+    Napi::Error::New(env, "Error: bindData: async calls are still running").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  data_store     = DataStore::Unwrap(arg0);
+  data_store_ref = Napi::Persistent(arg0);
 
   return Napi::Value();
 }
@@ -245,17 +604,44 @@ Napi::Value CoreEngine::bindScript(Napi::CallbackInfo const &info)
   REQUIRE_N_ARGS(info, 1);
   GET_ARG_OF_TYPE(info, 0, Object);
 
-  script_store = ScriptStore::Unwrap(arg0);
+  if (running_workers) {
+    Napi::Error::New(env, "Error: bindScript: async calls are still running").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  script_store     = ScriptStore::Unwrap(arg0);
+  script_store_ref = Napi::Persistent(arg0);
 
   return Napi::Value();
 }
 
+/**
+ * `duel_id' is not (or no longer) a live duel, `where' says which argument
+ * it came from if that is not obvious.
+ */
+static
+void throw_unknown_duel(Napi::Env env, duel_instance_id_t duel_id, std::string const &where = std::string())
+{
+  auto message = "Error: unknown duel " + std::to_string(duel_id);
+  if (!where.empty()) {
+    message += " (" + where + ")";
+  }
+  Napi::TypeError::New(env, message).ThrowAsJavaScriptException();
+}
+
 #define CHECK_DUEL(n)                                                                 \
   GET_ARG_OF_TYPE(info, n, Number);                                                   \
-  auto duel_id = arg0.Uint32Value();                                                  \
-  auto duel = wrapper->lookup(duel_id);                                               \
-  if (duel) {} else                                                                   \
-    Napi::TypeError::New(env, "Error: Number expected").ThrowAsJavaScriptException()
+  auto duel_id  = arg##n.Uint32Value();                                               \
+  auto instance = wrapper->find(duel_id);                                             \
+  if (!instance) {                                                                    \
+    throw_unknown_duel(env, duel_id);                                                 \
+    return Napi::Value();                                                             \
+  }                                                                                   \
+  if (instance->busy) {                                                               \
+    Napi::Error::New(env, "Error: duel is busy").ThrowAsJavaScriptException();        \
+    return Napi::Value();                                                             \
+  }                                                                                   \
+  [[maybe_unused]] auto duel = instance->duel
 
 #define CHECK_INT(n, name, ty)      \
   GET_ARG_OF_TYPE(info, n, Number); \
@@ -270,9 +656,16 @@ Napi::Value CoreEngine::createDuel(Napi::CallbackInfo const &info)
   CHECK_INT(0, seed, Uint32Value);
 
   switch_engine();
-  auto duel = api->create_duel(seed);
+  auto duel    = create_duel(seed);
+  auto duel_id = wrapper->acquire(env, duel, trace_capacity);
+  if (!duel_id) {
+    end_duel(duel);
+    Napi::Error::New(env, "Error: too many duels").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+  wrapper->find(duel_id)->journal.create(seed);
 
-  return Napi::Value::From(env, wrapper->acquire(duel));
+  return Napi::Value::From(env, duel_id);
 }
 
 
@@ -285,8 +678,9 @@ Napi::Value CoreEngine::startDuel(Napi::CallbackInfo const &info)
   CHECK_DUEL(0);
   CHECK_INT(1, options, Int32Value);
 
-  switch_engine();
+  switch_duel();
   api->start_duel(duel, options);
+  instance->journal.start(options);
 
   return Napi::Value();
 }
@@ -300,8 +694,9 @@ Napi::Value CoreEngine::endDuel(Napi::CallbackInfo const &info)
   REQUIRE_N_ARGS(info, 1);
   CHECK_DUEL(0);
 
-  switch_engine();
-  api->end_duel(duel);
+  switch_duel();
+  end_duel(duel);
+  retired_stats->add(*instance->stats);
   wrapper->release(duel_id);
 
   return Napi::Value();
@@ -321,23 +716,27 @@ Napi::Value CoreEngine::setPlayerInfo(Napi::CallbackInfo const &info)
   GET_INTEGER_PROPERTY(arg1, start,  Int32);
   GET_INTEGER_PROPERTY(arg1, draw,   Int32);
 
-  switch_engine();
+  switch_duel();
 
   api->set_player_info(duel, player, lp, start, draw);
+  instance->journal.player_info(player, lp, start, draw);
 
   return Napi::Value();
 }
 
+/**
+ * the last message ocgcore logged for the duel only, every message since
+ * the last drain is kept by `drainLog'.
+ */
 Napi::Value CoreEngine::getLogMessage(Napi::CallbackInfo const &info)
 {
-  // TODO: move this to CoreEngine::process. 2019-09-28 21:27:06
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
 
   REQUIRE_N_ARGS(info, 1);
   CHECK_DUEL(0);
 
-  switch_engine();
+  switch_duel();
 
   // void get_log_message(ptr pduel, byte* buf) {
   //   strcpy((char*)buf, ((duel*)pduel)->strbuffer);
@@ -349,6 +748,30 @@ Napi::Value CoreEngine::getLogMessage(Napi::CallbackInfo const &info)
   return Napi::Value::From(env, message_buffer);
 }
 
+std::int32_t CoreEngine::step( EngineContext const &context
+                             , DuelInstance        &instance
+                             , byte                *message_buffer)
+{
+  auto const context_scope = ContextScope( context
+                                         , instance.stats.get()
+                                         , instance.log.get()
+                                         , instance.trace.get());
+
+  auto const stopwatch      = Stopwatch();
+  auto       span           = TraceSpan(instance.trace.get(), trace_process);
+  auto const process_result = api->process(instance.duel);
+  span.arg = process_result & 0xFFFF;
+  instance.stats->time(timer_process, stopwatch.elapsed());
+
+  api->get_message(instance.duel, message_buffer);
+  instance.journal.step();
+
+  instance.stats->count(stat_process_calls);
+  instance.stats->count(stat_message_bytes, process_result & 0xFFFF);
+
+  return process_result;
+}
+
 Napi::Value CoreEngine::process(Napi::CallbackInfo const &info)
 {
   auto env   = info.Env();
@@ -357,15 +780,12 @@ Napi::Value CoreEngine::process(Napi::CallbackInfo const &info)
   REQUIRE_N_ARGS(info, 1);
   CHECK_DUEL(0);
 
-  switch_engine();
+  auto message_buff = new byte[0x1000];
 
-  auto const process_result = api->process(duel);
+  auto const process_result = step(context(), *instance, message_buff);
   auto const message_length = process_result &  0xFFFF;
   auto const process_flags  = process_result >> 16;
 
-  auto message_buff = new byte[0x1000];
-  api->get_message(duel, message_buff);
-
   auto buffer_object = Napi::ArrayBuffer::New(env, message_buff, message_length, finalizer);
   auto result_array  = Napi::Array::New(env, 2);
 
@@ -375,115 +795,1739 @@ Napi::Value CoreEngine::process(Napi::CallbackInfo const &info)
   return result_array;
 }
 
-Napi::Value CoreEngine::newCard(Napi::CallbackInfo const &info)
+/**
+ * remembers the last question among the duel's frames from `first_frame'
+ * on. a retry is for whoever got the question being retried.
+ */
+static
+void note_questions(DuelInstance &instance, std::size_t first_frame)
 {
-  auto env   = info.Env();
-  auto scope = Napi::HandleScope(env);
+  auto &frames = instance.frames;
+  for (auto i = first_frame; i != frames.size(); ++i) {
+    auto &frame = frames[i];
+    if (is_question(frame.type)) {
+      instance.last_question           = frame.type;
+      instance.last_question_recipient = frame.recipient;
+    } else if (frame.type == MSG_RETRY && instance.last_question) {
+      frame.recipient = instance.last_question_recipient;
+    }
+  }
+}
 
-  REQUIRE_N_ARGS(info, 2);
-  CHECK_DUEL(0);
-  GET_ARG_OF_TYPE(info, 1, Object);
+std::int32_t CoreEngine::run_until_decision( EngineContext  const &context
+                                           , DuelInstance         &instance
+                                           , MessageTypeSet const &stop_after)
+{
+  auto &output = instance.pending;
+  auto &frames = instance.frames;
 
-  GET_INTEGER_PROPERTY(arg1, code,     Uint32);
-  GET_INTEGER_PROPERTY(arg1, owner,    Uint32);
-  GET_INTEGER_PROPERTY(arg1, player,   Uint32);
-  GET_INTEGER_PROPERTY(arg1, location, Uint32);
-  GET_INTEGER_PROPERTY(arg1, sequence, Uint32);
-  GET_INTEGER_PROPERTY(arg1, position, Uint32);
+  output.clear();
+  frames.clear();
 
-  switch_engine();
+  for (;;) {
+    auto const offset = begin_step(output, message_buffer_size);
 
-  api->new_card(duel, code, owner, player, location, sequence, position);
+    auto const process_result = step(context, instance, output.data() + offset);
+    auto const message_length = process_result &  0xFFFF;
+    auto const process_flags  = process_result >> 16;
 
-  return Napi::Value();
+    auto const first_frame = frames.size();
+    auto const decision    = end_step(output, offset, message_length, frames, stop_after);
+
+    note_questions(instance, first_frame);
+
+    if (process_flags || decision || output.size() >= decision_buffer_limit) {
+      return process_flags;
+    }
+  }
 }
 
-Napi::Value CoreEngine::queryCard(Napi::CallbackInfo const &info)
+/**
+ * copies `frames' into a fresh ArrayBuffer, 12 bytes per message:
+ * offset (u32), length (u32), type (u8), recipient (u8), 2 bytes reserved.
+ */
+static
+Napi::ArrayBuffer wrap_frames(Napi::Env env, std::vector<MessageFrame> const &frames)
+{
+  auto const size  = frames.size() * sizeof(MessageFrame);
+  auto       index = new byte[size];
+  std::memcpy(index, frames.data(), size);
+
+  return Napi::ArrayBuffer::New(env, index, size, finalizer);
+}
+
+/**
+ * copies `size' bytes into `buffer', an external ArrayBuffer held by `ref'.
+ * a bigger one takes its place first if they do not fit, js holding the old
+ * one keeps it until collected.
+ */
+static
+void export_into( Napi::Env                           env
+                , byte const                         *data
+                , std::size_t                         size
+                , byte                              *&buffer
+                , std::size_t                        &capacity
+                , Napi::Reference<Napi::ArrayBuffer> &ref)
+{
+  if (ref.IsEmpty() || size > capacity) {
+    capacity = std::max({ size, capacity * 2, message_buffer_size });
+    buffer   = new byte[capacity];
+    ref      = Napi::Persistent(Napi::ArrayBuffer::New(env, buffer, capacity, finalizer));
+  }
+
+  if (size) {
+    std::memcpy(buffer, data, size);
+  }
+}
+
+/**
+ * like `process', but keeps stepping until a question, MSG_RETRY, MSG_WIN
+ * or any process flag shows up. returns `[length, flags, frames]': the
+ * messages of every step taken, back to back, are the first `length' bytes
+ * of `pendingBuffer(duel)'s buffer, its index holds their `frames' frames.
+ * nothing is allocated unless a batch outgrows those buffers.
+ *
+ * `runUntilDecision(duel, stopAfter)' also stops after a step that emitted
+ * any of the message types in `stopAfter', for callers that query the
+ * field as those messages come out.
+ */
+Napi::Value CoreEngine::runUntilDecision(Napi::CallbackInfo const &info)
 {
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
 
-  REQUIRE_N_ARGS(info, 2);
+  REQUIRE_N_ARGS(info, 1);
   CHECK_DUEL(0);
-  GET_ARG_OF_TYPE(info, 1, Object);
-
-  GET_INTEGER_PROPERTY(arg1, player,   Uint32);
-  GET_INTEGER_PROPERTY(arg1, location, Uint32);
-  GET_INTEGER_PROPERTY(arg1, flags,    Uint32);
-  GET_INTEGER_PROPERTY(arg1, sequence, Uint32);
-  auto cache_property = arg1.Get("cache");
-  REQUIRE_OF_TYPE(cache_property, Boolean);
-  auto cache = cache_property.As<Napi::Boolean>().Value();
 
-  switch_engine();
+  auto stop_after = MessageTypeSet();
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    GET_ARG_OF_TYPE(info, 1, Array);
+    for (std::uint32_t i = 0; i != arg1.Length(); ++i) {
+      auto const type = arg1.Get(i);
+      REQUIRE_OF_TYPE(type, Number);
+      stop_after.set(type.As<Napi::Number>().Uint32Value() & 0xFF);
+    }
+  }
 
-  auto query_buffer = new byte[0x4000];
-  auto buffer_length = api->query_card(duel, player, location, sequence, flags, query_buffer, cache);
+  auto const &pending      = instance->pending;
+  auto const &frames       = instance->frames;
+  auto const process_flags = run_until_decision(context(), *instance, stop_after);
+
+  export_into( env
+             , pending.data()
+             , pending.size()
+             , instance->pending_buffer
+             , instance->pending_capacity
+             , instance->pending_buffer_ref);
+  export_into( env
+             , reinterpret_cast<byte const *>(frames.data())
+             , frames.size() * sizeof(MessageFrame)
+             , instance->frame_buffer
+             , instance->frame_capacity
+             , instance->frame_buffer_ref);
+
+  auto result_array = Napi::Array::New(env, 3);
+
+  result_array.Set(0u, Napi::Value::From(env, static_cast<std::uint32_t>(pending.size())));
+  result_array.Set(1,  Napi::Value::From(env, process_flags));
+  result_array.Set(2,  Napi::Value::From(env, static_cast<std::uint32_t>(frames.size())));
 
-  return Napi::ArrayBuffer::New(env, query_buffer, buffer_length, finalizer);
+  return result_array;
 }
 
-Napi::Value CoreEngine::queryFieldCount(Napi::CallbackInfo const &info)
+/**
+ * `[messages, index]': where the last `runUntilDecision(duel)' left its
+ * messages and their frames (see `wrap_frames'), empty before the first.
+ * both are replaced (never shrunk) when a batch outgrows them, so holders
+ * need to fetch them again once the length or frame count returned by
+ * `runUntilDecision' is past what they have.
+ */
+Napi::Value CoreEngine::pendingBuffer(Napi::CallbackInfo const &info)
 {
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
 
-  REQUIRE_N_ARGS(info, 3);
+  REQUIRE_N_ARGS(info, 1);
   CHECK_DUEL(0);
-  CHECK_INT(1, player, Uint32Value);
-  CHECK_INT(2, location, Uint32Value);
 
-  switch_engine();
+  auto result_array = Napi::Array::New(env, 2);
 
-  return Napi::Value::From(env, api->query_field_count(duel, player, location));
+  result_array.Set(0u, instance->pending_buffer_ref.IsEmpty() ? Napi::ArrayBuffer::New(env, 0) : instance->pending_buffer_ref.Value());
+  result_array.Set(1,  instance->frame_buffer_ref.IsEmpty()   ? Napi::ArrayBuffer::New(env, 0) : instance->frame_buffer_ref.Value());
+
+  return result_array;
 }
 
-Napi::Value CoreEngine::queryFieldCard(Napi::CallbackInfo const &info)
+/**
+ * the bytes of an ArrayBuffer or a TypedArray (a Buffer included), false
+ * if `value' is neither.
+ */
+static
+bool view_bytes(Napi::Value value, byte const *&data, std::size_t &length)
+{
+  if (value.IsTypedArray()) {
+    auto view = value.As<Napi::TypedArray>();
+    data   = static_cast<byte const *>(view.ArrayBuffer().Data()) + view.ByteOffset();
+    length = view.ByteLength();
+    return true;
+  }
+
+  if (value.IsArrayBuffer()) {
+    auto buffer = value.As<Napi::ArrayBuffer>();
+    data   = static_cast<byte const *>(buffer.Data());
+    length = buffer.ByteLength();
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * frames a buffer of messages (e.g. from `process'), returns the index as
+ * `runUntilDecision' does.
+ */
+Napi::Value CoreEngine::indexMessages(Napi::CallbackInfo const &info)
 {
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
 
-  REQUIRE_N_ARGS(info, 2);
-  CHECK_DUEL(0);
-  GET_ARG_OF_TYPE(info, 1, Object);
+  REQUIRE_N_ARGS(info, 1);
 
-  GET_INTEGER_PROPERTY(arg1, player, Uint32);
-  GET_INTEGER_PROPERTY(arg1, location, Uint32);
-  GET_INTEGER_PROPERTY(arg1, flags, Uint32);
-  auto cache_property = arg1.Get("cache");
-  REQUIRE_OF_TYPE(cache_property, Boolean);
-  auto cache = cache_property.As<Napi::Boolean>().Value();
+  byte const  *data   = nullptr;
+  std::size_t  length = 0;
 
-  switch_engine();
+  if (!view_bytes(info[0], data, length)) {
+    Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
 
-  auto query_buffer = new byte[0x4000];
-  auto buffer_length = api->query_field_card(duel, player, location, flags, query_buffer, cache);
+  auto frames = std::vector<MessageFrame>();
+  frame_messages(data, length, 0, frames);
 
-  return Napi::ArrayBuffer::New(env, query_buffer, buffer_length, finalizer);
+  return wrap_frames(env, frames);
 }
 
-Napi::Value CoreEngine::setResponse(Napi::CallbackInfo const &info)
+/**
+ * `splitViews(messages, index)': what each player, and spectators, get to
+ * see of a buffer of framed messages (from `runUntilDecision',
+ * `refreshBatch' or `indexMessages'), see `split_views'. returns
+ * `[[messages, index], [messages, index], [messages, index]]', for player
+ * 0, player 1 and spectators.
+ */
+Napi::Value CoreEngine::splitViews(Napi::CallbackInfo const &info)
 {
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
 
   REQUIRE_N_ARGS(info, 2);
-  CHECK_DUEL(0);
-  GET_ARG_OF_TYPE(info, 1, ArrayBuffer);
 
-  if (arg1.ByteLength() > 64) {
-    TRACEF("ByteLength: %zu", arg1.ByteLength());
-    Napi::RangeError::New(env, "response buffer is too large (> 64 bytes)").ThrowAsJavaScriptException();
+  byte const  *data         = nullptr;
+  std::size_t  length       = 0;
+  byte const  *index        = nullptr;
+  std::size_t  index_length = 0;
+
+  if (!view_bytes(info[0], data, length) || !view_bytes(info[1], index, index_length)) {
+    Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+    return Napi::Value();
   }
 
-  byte response_buffer[64];
-  std::memset(response_buffer, 0, sizeof response_buffer);
-  std::memcpy(response_buffer, arg1.Data(), arg1.ByteLength());
+  auto frames = std::vector<MessageFrame>(index_length / sizeof(MessageFrame));
+  if (!frames.empty()) {
+    std::memcpy(frames.data(), index, frames.size() * sizeof(MessageFrame));
+  }
 
-  switch_engine();
-  api->set_responseb(duel, response_buffer);
+  for (auto const &frame: frames) {
+    if (frame.offset > length || frame.length > length - frame.offset) {
+      Napi::RangeError::New(env, "Error: index does not match messages").ThrowAsJavaScriptException();
+      return Napi::Value();
+    }
+  }
 
-  return Napi::Value();
+  auto views = MessageViews();
+  split_views(data, frames.data(), frames.size(), views);
+
+  auto result_array = Napi::Array::New(env, view_count);
+  for (std::uint32_t view = 0; view != view_count; ++view) {
+    auto const &messages     = views.messages[view];
+    auto        message_buff = new byte[messages.size()];
+    if (!messages.empty()) {
+      std::memcpy(message_buff, messages.data(), messages.size());
+    }
+
+    auto pair = Napi::Array::New(env, 2);
+    pair.Set(0u, Napi::ArrayBuffer::New(env, message_buff, messages.size(), finalizer));
+    pair.Set(1,  wrap_frames(env, views.frames[view]));
+    result_array.Set(view, pair);
+  }
+
+  return result_array;
+}
+
+/**
+ * runs `CoreEngine::step' on the libuv thread pool, messages go to
+ * `messageBuffer(duel)' as with `processInto'. settles a promise of
+ * `[length, flags]'.
+ *
+ * the duel is marked busy until the promise settles, so it is never stepped
+ * by two threads at once, nor ended while its buffer is being written.
+ */
+struct CoreEngine::ProcessWorker : public Napi::AsyncWorker
+{
+  CoreEngine              *engine;
+  EngineContext const      context;
+  duel_instance_id_t       duel_id;
+  DuelInstance            *instance;
+  Napi::Promise::Deferred  deferred;
+  std::int32_t             process_result = 0;
+
+  ProcessWorker( Napi::Env          env
+               , CoreEngine        *engine
+               , duel_instance_id_t duel_id
+               , DuelInstance      *instance)
+    : Napi::AsyncWorker(env)
+    , engine(engine)
+    , context(engine->context())
+    , duel_id(duel_id)
+    , instance(instance)
+    , deferred(Napi::Promise::Deferred::New(env))
+  {
+    engine->hold_for_worker();
+    engine->wrapper->set_busy(duel_id, true);
+  }
+
+  void Execute() override
+  {
+    process_result = engine->step(context, *instance, instance->message_buffer);
+  }
+
+  void OnOK() override
+  {
+    auto env   = Env();
+    auto scope = Napi::HandleScope(env);
+
+    settle();
+
+    auto const message_length = process_result &  0xFFFF;
+    auto const process_flags  = process_result >> 16;
+
+    auto result_array = Napi::Array::New(env, 2);
+
+    result_array.Set(0u, Napi::Value::From(env, message_length));
+    result_array.Set(1,  Napi::Value::From(env, process_flags));
+
+    deferred.Resolve(result_array);
+  }
+
+  void OnError(Napi::Error const &error) override
+  {
+    settle();
+    deferred.Reject(error.Value());
+  }
+
+private:
+  void settle()
+  {
+    engine->wrapper->set_busy(duel_id, false);
+    engine->release_from_worker();
+  }
+};
+
+Napi::Value CoreEngine::processAsync(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  CHECK_DUEL(0);
+
+  if (!require_frozen_stores(env)) {
+    return Napi::Value();
+  }
+
+  auto worker  = new ProcessWorker(env, this, duel_id, instance);
+  auto promise = worker->deferred.Promise();
+  worker->Queue(); // deletes itself once settled.
+
+  return promise;
+}
+
+/**
+ * one duel of a `stepMany' batch.
+ */
+struct BatchItem
+{
+  duel_instance_id_t duel_id      = 0;
+  DuelInstance      *instance     = nullptr;
+  bool               has_response    = false;
+  byte               response[64]    = { };
+  std::size_t        response_length = 0;
+  std::int32_t       flags        = 0;
+};
+
+/**
+ * a `stepMany' result entry, 6 u32 per duel, handed to js as is.
+ */
+struct BatchEntry
+{
+  std::uint32_t duel;
+  std::uint32_t flags;
+  std::uint32_t offset;
+  std::uint32_t length;
+  std::uint32_t first_frame;
+  std::uint32_t frame_count;
+};
+
+static_assert(sizeof(BatchEntry) == 24, "BatchEntry layout changed");
+
+/**
+ * reads `[[duel, response?], ...]' into `items'. throws (and returns
+ * false) on unknown, busy or repeated duels, or oversized responses.
+ */
+static
+bool read_batch( Napi::Env               env
+               , CoreEngine::Wrapper    &wrapper
+               , Napi::Array             batch
+               , std::vector<BatchItem> &items);
+
+void CoreEngine::run_batch( EngineContext const    &context
+                          , std::vector<BatchItem> &items
+                          , std::uint32_t           threads)
+{
+  auto run_one = [&](BatchItem &item) {
+    auto const duel = item.instance->duel;
+    if (item.has_response) {
+      auto const context_scope = ContextScope( context
+                                             , item.instance->stats.get()
+                                             , item.instance->log.get()
+                                             , item.instance->trace.get());
+      auto const stopwatch     = Stopwatch();
+      auto const span          = TraceSpan(item.instance->trace.get(), trace_set_response, item.response_length);
+      api->set_responseb(duel, item.response);
+      item.instance->stats->time(timer_set_response, stopwatch.elapsed());
+      item.instance->journal.response(item.response, item.response_length);
+    }
+    item.flags = run_until_decision(context, *item.instance);
+  };
+
+  ThreadPool::shared().parallel_for(items.size(), threads, [&](std::size_t i) { run_one(items[i]); });
+}
+
+/**
+ * gathers what each duel of a batch emitted into `[messages, entries,
+ * index]': all messages back to back, one `BatchEntry' per duel (in batch
+ * order), and one frame per message as in `runUntilDecision', with offsets
+ * into `messages'.
+ */
+static
+Napi::Array wrap_batch(Napi::Env env, std::vector<BatchItem> const &items)
+{
+  std::size_t total_length = 0;
+  std::size_t total_frames = 0;
+  for (auto const &item: items) {
+    total_length += item.instance->pending.size();
+    total_frames += item.instance->frames.size();
+  }
+
+  auto messages = new byte[total_length];
+  auto entries  = new byte[items.size() * sizeof(BatchEntry)];
+  auto frames   = std::vector<MessageFrame>();
+  frames.reserve(total_frames);
+
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i != items.size(); ++i) {
+    auto const &item    = items[i];
+    auto const &pending = item.instance->pending;
+
+    auto const entry = BatchEntry { item.duel_id
+                                  , std::uint32_t(item.flags)
+                                  , std::uint32_t(offset)
+                                  , std::uint32_t(pending.size())
+                                  , std::uint32_t(frames.size())
+                                  , std::uint32_t(item.instance->frames.size()) };
+    std::memcpy(entries + i * sizeof(BatchEntry), &entry, sizeof entry);
+
+    for (auto frame: item.instance->frames) {
+      frame.offset += offset;
+      frames.push_back(frame);
+    }
+
+    std::memcpy(messages + offset, pending.data(), pending.size());
+    offset += pending.size();
+  }
+
+  auto result_array = Napi::Array::New(env, 3);
+  result_array.Set(0u, Napi::ArrayBuffer::New(env, messages, total_length, finalizer));
+  result_array.Set(1,  Napi::ArrayBuffer::New(env, entries, items.size() * sizeof(BatchEntry), finalizer));
+  result_array.Set(2,  wrap_frames(env, frames));
+
+  return result_array;
+}
+
+static
+bool read_batch( Napi::Env               env
+               , CoreEngine::Wrapper    &wrapper
+               , Napi::Array             batch
+               , std::vector<BatchItem> &items)
+{
+  items.resize(batch.Length());
+
+  for (std::uint32_t i = 0; i != batch.Length(); ++i) {
+    auto  pair = batch.Get(i);
+    auto &item = items[i];
+
+    if (!pair.IsArray() || pair.As<Napi::Array>().Length() < 1) {
+      Napi::TypeError::New(env, "Error: [duel, response?] expected").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    auto const duel_id  = pair.As<Napi::Array>().Get(0u);
+    auto const response = pair.As<Napi::Array>().Get(1);
+
+    item.duel_id  = duel_id.IsNumber() ? duel_id.As<Napi::Number>().Uint32Value() : 0;
+    item.instance = wrapper.find(item.duel_id);
+    if (!item.instance) {
+      throw_unknown_duel(env, item.duel_id, "batch[" + std::to_string(i) + "]");
+      return false;
+    }
+    if (item.instance->busy) {
+      Napi::Error::New(env, "Error: duel is busy (batch[" + std::to_string(i) + "])").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    byte const  *data   = nullptr;
+    std::size_t  length = 0;
+
+    if (!view_bytes(response, data, length) && !response.IsUndefined() && !response.IsNull()) {
+      Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    if (length > sizeof item.response) {
+      Napi::RangeError::New(env, "response buffer is too large (> 64 bytes)").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    item.has_response    = data != nullptr;
+    item.response_length = length;
+    if (data) {
+      std::memcpy(item.response, data, length);
+    }
+  }
+
+  auto ids = std::vector<duel_instance_id_t>();
+  for (auto const &item: items) {
+    ids.push_back(item.duel_id);
+  }
+  std::sort(ids.begin(), ids.end());
+  if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+    Napi::Error::New(env, "Error: duel appears twice in batch").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * `stepMany([[duel, response?], ...], threads)': sets each response (if
+ * any) and runs each duel until its next decision (see `runUntilDecision'),
+ * on up to `threads' threads. returns `[messages, entries, index]', see
+ * `wrap_batch'.
+ */
+Napi::Value CoreEngine::stepMany(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  GET_ARG_OF_TYPE(info, 0, Array);
+  CHECK_INT(1, threads, Uint32Value);
+
+  if (threads > 1 && !require_frozen_stores(env)) {
+    return Napi::Value();
+  }
+
+  auto items = std::vector<BatchItem>();
+  if (!read_batch(env, *wrapper, arg0, items)) {
+    return Napi::Value();
+  }
+
+  run_batch(context(), items, threads);
+
+  return wrap_batch(env, items);
+}
+
+/**
+ * `stepMany' off the main thread, settles a promise of the same result.
+ * every duel in the batch stays busy until then.
+ */
+struct CoreEngine::BatchWorker : public Napi::AsyncWorker
+{
+  CoreEngine              *engine;
+  EngineContext const      context;
+  std::vector<BatchItem>   items;
+  std::uint32_t            threads;
+  Napi::Promise::Deferred  deferred;
+
+  BatchWorker( Napi::Env                env
+             , CoreEngine              *engine
+             , std::vector<BatchItem> &&items
+             , std::uint32_t            threads)
+    : Napi::AsyncWorker(env)
+    , engine(engine)
+    , context(engine->context())
+    , items(std::move(items))
+    , threads(threads)
+    , deferred(Napi::Promise::Deferred::New(env))
+  {
+    engine->hold_for_worker();
+    for (auto &item: this->items) {
+      item.instance->busy = true;
+    }
+  }
+
+  void Execute() override
+  {
+    engine->run_batch(context, items, threads);
+  }
+
+  void OnOK() override
+  {
+    auto env   = Env();
+    auto scope = Napi::HandleScope(env);
+
+    settle();
+    deferred.Resolve(wrap_batch(env, items));
+  }
+
+  void OnError(Napi::Error const &error) override
+  {
+    settle();
+    deferred.Reject(error.Value());
+  }
+
+private:
+  void settle()
+  {
+    for (auto &item: items) {
+      item.instance->busy = false;
+    }
+    engine->release_from_worker();
+  }
+};
+
+Napi::Value CoreEngine::stepManyAsync(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  GET_ARG_OF_TYPE(info, 0, Array);
+  CHECK_INT(1, threads, Uint32Value);
+
+  if (!require_frozen_stores(env)) {
+    return Napi::Value();
+  }
+
+  auto items = std::vector<BatchItem>();
+  if (!read_batch(env, *wrapper, arg0, items)) {
+    return Napi::Value();
+  }
+
+  auto worker  = new BatchWorker(env, this, std::move(items), threads);
+  auto promise = worker->deferred.Promise();
+  worker->Queue(); // deletes itself once settled.
+
+  return promise;
+}
+
+Napi::Value CoreEngine::newCard(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, Object);
+
+  GET_INTEGER_PROPERTY(arg1, code,     Uint32);
+  GET_INTEGER_PROPERTY(arg1, owner,    Uint32);
+  GET_INTEGER_PROPERTY(arg1, player,   Uint32);
+  GET_INTEGER_PROPERTY(arg1, location, Uint32);
+  GET_INTEGER_PROPERTY(arg1, sequence, Uint32);
+  GET_INTEGER_PROPERTY(arg1, position, Uint32);
+
+  switch_duel();
+
+  api->new_card(duel, code, owner, player, location, sequence, position);
+  instance->journal.new_card(code, owner, player, location, sequence, position);
+
+  return Napi::Value();
+}
+
+Napi::Value CoreEngine::queryCard(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, Object);
+
+  GET_INTEGER_PROPERTY(arg1, player,   Uint32);
+  GET_INTEGER_PROPERTY(arg1, location, Uint32);
+  GET_INTEGER_PROPERTY(arg1, flags,    Uint32);
+  GET_INTEGER_PROPERTY(arg1, sequence, Uint32);
+  auto cache_property = arg1.Get("cache");
+  REQUIRE_OF_TYPE(cache_property, Boolean);
+  auto cache = cache_property.As<Napi::Boolean>().Value();
+
+  switch_duel();
+
+  auto query_buffer = new byte[0x4000];
+  auto const span    = TraceSpan(instance->trace.get(), trace_query_card, location);
+  auto buffer_length = api->query_card(duel, player, location, sequence, flags, query_buffer, cache);
+  instance->stats->count(stat_query_calls);
+
+  return Napi::ArrayBuffer::New(env, query_buffer, buffer_length, finalizer);
+}
+
+Napi::Value CoreEngine::queryFieldCount(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 3);
+  CHECK_DUEL(0);
+  CHECK_INT(1, player, Uint32Value);
+  CHECK_INT(2, location, Uint32Value);
+
+  switch_duel();
+
+  instance->stats->count(stat_query_calls);
+
+  auto const span = TraceSpan(instance->trace.get(), trace_query_field_count, location);
+  return Napi::Value::From(env, api->query_field_count(duel, player, location));
+}
+
+Napi::Value CoreEngine::queryFieldCard(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, Object);
+
+  GET_INTEGER_PROPERTY(arg1, player, Uint32);
+  GET_INTEGER_PROPERTY(arg1, location, Uint32);
+  GET_INTEGER_PROPERTY(arg1, flags, Uint32);
+  auto cache_property = arg1.Get("cache");
+  REQUIRE_OF_TYPE(cache_property, Boolean);
+  auto cache = cache_property.As<Napi::Boolean>().Value();
+
+  switch_duel();
+
+  auto query_buffer = new byte[0x4000];
+  auto const stopwatch     = Stopwatch();
+  auto const span          = TraceSpan(instance->trace.get(), trace_query_field_card, location);
+  auto       buffer_length = api->query_field_card(duel, player, location, flags, query_buffer, cache);
+  instance->stats->time(timer_query_field_card, stopwatch.elapsed());
+  instance->stats->count(stat_query_calls);
+
+  return Napi::ArrayBuffer::New(env, query_buffer, buffer_length, finalizer);
+}
+
+Napi::Value CoreEngine::setResponse(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, ArrayBuffer);
+
+  if (arg1.ByteLength() > 64) {
+    TRACEF("ByteLength: %zu", arg1.ByteLength());
+    Napi::RangeError::New(env, "response buffer is too large (> 64 bytes)").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  byte response_buffer[64];
+  std::memset(response_buffer, 0, sizeof response_buffer);
+  std::memcpy(response_buffer, arg1.Data(), arg1.ByteLength());
+
+  switch_duel();
+  auto const stopwatch = Stopwatch();
+  auto const span      = TraceSpan(instance->trace.get(), trace_set_response, arg1.ByteLength());
+  api->set_responseb(duel, response_buffer);
+  instance->stats->time(timer_set_response, stopwatch.elapsed());
+  instance->journal.response(response_buffer, arg1.ByteLength());
+
+  return Napi::Value();
+}
+
+Napi::Value CoreEngine::messageBuffer(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  CHECK_DUEL(0);
+
+  return instance->message_buffer_ref.Value();
+}
+
+Napi::Value CoreEngine::queryBuffer(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  CHECK_DUEL(0);
+
+  return instance->query_buffer_ref.Value();
+}
+
+/**
+ * like `process', messages go to `messageBuffer(duel)'. returns the raw
+ * process result: message length in the low 16 bits, flags above.
+ */
+Napi::Value CoreEngine::processInto(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  CHECK_DUEL(0);
+
+  return Napi::Value::From(env, step(context(), *instance, instance->message_buffer));
+}
+
+/**
+ * like `queryCard', the result goes to `queryBuffer(duel)'. returns its length.
+ */
+Napi::Value CoreEngine::queryCardInto(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, Object);
+
+  GET_INTEGER_PROPERTY(arg1, player,   Uint32);
+  GET_INTEGER_PROPERTY(arg1, location, Uint32);
+  GET_INTEGER_PROPERTY(arg1, flags,    Uint32);
+  GET_INTEGER_PROPERTY(arg1, sequence, Uint32);
+  auto cache_property = arg1.Get("cache");
+  REQUIRE_OF_TYPE(cache_property, Boolean);
+  auto cache = cache_property.As<Napi::Boolean>().Value();
+
+  switch_duel();
+
+  instance->stats->count(stat_query_calls);
+
+  auto const span = TraceSpan(instance->trace.get(), trace_query_card, location);
+  return Napi::Value::From(env, api->query_card(duel, player, location, sequence, flags, instance->query_buffer, cache));
+}
+
+/**
+ * like `queryFieldCard', the result goes to `queryBuffer(duel)'. returns its length.
+ */
+Napi::Value CoreEngine::queryFieldCardInto(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, Object);
+
+  GET_INTEGER_PROPERTY(arg1, player, Uint32);
+  GET_INTEGER_PROPERTY(arg1, location, Uint32);
+  GET_INTEGER_PROPERTY(arg1, flags, Uint32);
+  auto cache_property = arg1.Get("cache");
+  REQUIRE_OF_TYPE(cache_property, Boolean);
+  auto cache = cache_property.As<Napi::Boolean>().Value();
+
+  switch_duel();
+
+  auto const stopwatch = Stopwatch();
+  auto const span      = TraceSpan(instance->trace.get(), trace_query_field_card, location);
+  auto const length    = api->query_field_card(duel, player, location, flags, instance->query_buffer, cache);
+  instance->stats->time(timer_query_field_card, stopwatch.elapsed());
+  instance->stats->count(stat_query_calls);
+
+  return Napi::Value::From(env, length);
+}
+
+/**
+ * runs a list of queries, `[{ player, location, flags, sequence?, cache?,
+ * incremental? }, ...]', one `query_card' for each entry with a sequence,
+ * one `query_field_card' for each without. results are framed as
+ * MSG_UPDATE_CARD / MSG_UPDATE_DATA the way the host has always sent them,
+ * and returned back to back as `[ArrayBuffer, index]' (index as in
+ * `runUntilDecision').
+ *
+ * `cache' is passed on to ocgcore, which then leaves out fields that did
+ * not change since its last cached query of the card. `incremental' drops
+ * cards whose chunk is the same as last time (see `diff_chunks'), and
+ * whole messages if nothing in them changed.
+ *
+ * MSG_UPDATE_DATA runs to the end of whatever buffer it is parsed from, so
+ * decode each message from its own slice.
+ */
+Napi::Value CoreEngine::refreshBatch(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  CHECK_DUEL(0);
+  GET_ARG_OF_TYPE(info, 1, Array);
+
+  auto &output   = instance->refresh;
+  auto &frames   = instance->refresh_frames;
+
+  output.clear();
+  frames.clear();
+
+  switch_duel();
+
+  for (std::uint32_t i = 0, n = arg1.Length(); i != n; ++i) {
+    auto item = arg1.Get(i);
+    REQUIRE_OF_TYPE(item, Object);
+    auto query = item.As<Napi::Object>();
+
+    GET_INTEGER_PROPERTY(query, player,   Uint32);
+    GET_INTEGER_PROPERTY(query, location, Uint32);
+    GET_INTEGER_PROPERTY(query, flags,    Uint32);
+    auto const single      = query.Has("sequence");
+    auto const cache       = query.Has("cache")       && query.Get("cache").ToBoolean().Value();
+    auto const incremental = query.Has("incremental") && query.Get("incremental").ToBoolean().Value();
+
+    auto const offset      = output.size();
+    auto const header_size = single ? 4 : 3;
+    output.resize(offset + header_size + query_buffer_size);
+
+    auto header = output.data() + offset;
+    header[0] = single ? MSG_UPDATE_CARD : MSG_UPDATE_DATA;
+    header[1] = player;
+    header[2] = location;
+
+    std::int32_t length      = 0;
+    std::int32_t at_sequence = -1;
+    if (single) {
+      GET_INTEGER_PROPERTY(query, sequence, Uint32);
+      header[3]   = sequence;
+      at_sequence = sequence;
+      auto const span = TraceSpan(instance->trace.get(), trace_query_card, location);
+      length = api->query_card(duel, player, location, sequence, flags, header + header_size, cache);
+    } else {
+      auto const stopwatch = Stopwatch();
+      auto const span      = TraceSpan(instance->trace.get(), trace_query_field_card, location);
+      length = api->query_field_card(duel, player, location, flags, header + header_size, cache);
+      instance->stats->time(timer_query_field_card, stopwatch.elapsed());
+    }
+    instance->stats->count(stat_query_calls);
+
+    auto changed = false;
+    length = diff_chunks( instance->last_chunks
+                        , header + header_size
+                        , length
+                        , player
+                        , location
+                        , at_sequence
+                        , incremental
+                        , changed);
+
+    if (incremental && !changed) {
+      output.resize(offset);
+      continue;
+    }
+
+    output.resize(offset + header_size + length);
+    frames.push_back(MessageFrame { std::uint32_t(offset)
+                                  , std::uint32_t(header_size + length)
+                                  , header[0]
+                                  , recipient_all
+                                  , 0 });
+  }
+
+  auto refresh_buff = new byte[output.size()];
+  std::memcpy(refresh_buff, output.data(), output.size());
+
+  auto result_array = Napi::Array::New(env, 2);
+  result_array.Set(0u, Napi::ArrayBuffer::New(env, refresh_buff, output.size(), finalizer));
+  result_array.Set(1,  wrap_frames(env, frames));
+
+  return result_array;
+}
+
+/**
+ * everything needed to bring a duel back to where it is now, see
+ * `DuelJournal' for what that means (and why it is not ocgcore's state).
+ */
+Napi::Value CoreEngine::snapshotDuel(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  CHECK_DUEL(0);
+
+  auto const image    = instance->journal.serialize();
+  auto       snapshot = new byte[image.size()];
+  std::memcpy(snapshot, image.data(), image.size());
+
+  return Napi::ArrayBuffer::New(env, snapshot, image.size(), finalizer);
+}
+
+duel_instance_id_t CoreEngine::replay_journal( Napi::Env                        env
+                                             , DuelJournal const               &journal
+                                             , std::vector<JournalEntry> const &entries)
+{
+  switch_engine();
+
+  auto const duel    = create_duel(std::uint32_t(entries.front().args[0]));
+  auto const duel_id = wrapper->acquire(env, duel, trace_capacity);
+  if (!duel_id) {
+    end_duel(duel);
+    Napi::Error::New(env, "Error: too many duels").ThrowAsJavaScriptException();
+    return 0;
+  }
+
+  auto &instance = *wrapper->find(duel_id);
+
+  for (auto const &entry: entries) {
+    auto const &args = entry.args;
+
+    switch (entry.op) {
+      case journal_create:
+        break;
+
+      case journal_player_info:
+        api->set_player_info(duel, args[0], args[1], args[2], args[3]);
+        break;
+
+      case journal_new_card:
+        api->new_card(duel, args[0], args[1], args[2], args[3], args[4], args[5]);
+        break;
+
+      case journal_start:
+        api->start_duel(duel, args[0]);
+        break;
+
+      case journal_response: {
+        for (std::int32_t i = 0; i != args[0]; ++i) {
+          step(engine_context, instance, instance.message_buffer);
+        }
+
+        byte response_buffer[64] = { };
+        std::memcpy(response_buffer, entry.response, entry.response_length);
+        api->set_responseb(duel, response_buffer);
+        break;
+      }
+    }
+  }
+
+  /* what the duel emitted since its last response, the question it is
+     waiting on among them. */
+  auto &output = instance.pending;
+  output.clear();
+  instance.frames.clear();
+
+  for (std::uint32_t i = 0; i != journal.trailing_steps(); ++i) {
+    auto const offset = output.size();
+    output.resize(offset + message_buffer_size);
+
+    auto const message_length = step(engine_context, instance, output.data() + offset) & 0xFFFF;
+    output.resize(offset + message_length);
+    frame_messages(output.data() + offset, message_length, offset, instance.frames);
+  }
+  note_questions(instance, 0);
+
+  instance.journal = journal;
+
+  return duel_id;
+}
+
+/**
+ * `[duel, messages, index]', the new duel, and what it emitted since its
+ * last response (framed as in `runUntilDecision').
+ */
+static
+Napi::Value wrap_restored( Napi::Env           env
+                         , duel_instance_id_t  duel_id
+                         , DuelInstance const &instance)
+{
+  auto const &pending      = instance.pending;
+  auto        message_buff = new byte[pending.size()];
+  std::memcpy(message_buff, pending.data(), pending.size());
+
+  auto result_array = Napi::Array::New(env, 3);
+  result_array.Set(0u, Napi::Value::From(env, duel_id));
+  result_array.Set(1,  Napi::ArrayBuffer::New(env, message_buff, pending.size(), finalizer));
+  result_array.Set(2,  wrap_frames(env, instance.frames));
+
+  return result_array;
+}
+
+/**
+ * a new duel from what `snapshotDuel' returned, using the current bindings.
+ * returns `[duel, messages, index]', see `wrap_restored'.
+ */
+Napi::Value CoreEngine::restoreDuel(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+
+  byte const  *data   = nullptr;
+  std::size_t  length = 0;
+
+  if (!view_bytes(info[0], data, length)) {
+    Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto journal = DuelJournal();
+  auto entries = std::vector<JournalEntry>();
+  auto error   = std::string();
+  if (!journal.load(data, length, entries, error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto const duel_id = replay_journal(env, journal, entries);
+  if (!duel_id) {
+    return Napi::Value();
+  }
+
+  return wrap_restored(env, duel_id, *wrapper->find(duel_id));
+}
+
+/**
+ * `restoreDuel(snapshotDuel(duel))'.
+ */
+Napi::Value CoreEngine::forkDuel(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  CHECK_DUEL(0);
+
+  auto const image = instance->journal.serialize();
+
+  auto journal = DuelJournal();
+  auto entries = std::vector<JournalEntry>();
+  auto error   = std::string();
+  if (!journal.load(image.data(), image.size(), entries, error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto const fork_id = replay_journal(env, journal, entries);
+  if (!fork_id) {
+    return Napi::Value();
+  }
+
+  return wrap_restored(env, fork_id, *wrapper->find(fork_id));
+}
+
+/**
+ * where `DuelDriver' puts a deck, face down.
+ */
+static constexpr std::uint8_t location_deck     = 0x01;
+static constexpr std::uint8_t location_extra    = 0x40;
+static constexpr std::uint8_t position_facedown = 0x0A;
+
+void CoreEngine::verify_replay(EngineContext const &context, ReplayJob &job)
+{
+  auto const  context_scope = ContextScope(context);
+  auto const &setup         = job.setup;
+  auto const &responses     = job.responses;
+  auto       &verdict       = job.verdict;
+
+  verdict       = ReplayVerdict();
+  verdict.total = responses.size();
+
+  auto const duel = create_duel(setup.seed);
+  for (std::uint8_t player = 0; player != 2; ++player) {
+    auto const &deck = setup.decks[player];
+    api->set_player_info(duel, player, setup.lp, setup.start, setup.draw);
+    for (auto code: deck.main) {
+      api->new_card(duel, code, player, player, location_deck, 0, position_facedown);
+    }
+    for (auto code: deck.extra) {
+      api->new_card(duel, code, player, player, location_extra, 0, position_facedown);
+    }
+  }
+  api->start_duel(duel, setup.options);
+
+  byte message_buffer[message_buffer_size];
+  auto frames = std::vector<MessageFrame>();
+
+  /* steps since the last decision, a duel that goes on without asking for
+     one is stuck. */
+  std::uint32_t idle = 0;
+  for (;;) {
+    if (idle++ == replay_step_limit) {
+      verdict.outcome = replay_stalled;
+      break;
+    }
+
+    auto const process_result = api->process(duel);
+    auto const length         = process_result &  0xFFFF;
+    auto const process_flags  = process_result >> 16;
+    api->get_message(duel, message_buffer);
+    ++verdict.steps;
+
+    frames.clear();
+    frame_messages(message_buffer, length, 0, frames);
+
+    auto asked = false;
+    auto done  = false;
+    for (auto const &frame: frames) {
+      auto const message = message_buffer + frame.offset;
+
+      if (message_length(message, frame.length) != frame.length) {
+        verdict.outcome = replay_malformed;
+        done = true;
+      } else if (frame.type == MSG_RETRY) {
+        verdict.outcome  = replay_retry;
+        verdict.retry_at = verdict.consumed ? verdict.consumed - 1 : 0;
+        done = true;
+      } else if (frame.type == MSG_WIN) {
+        verdict.outcome = replay_finished;
+        verdict.winner  = message[1];
+        verdict.reason  = message[2];
+        done = true;
+      } else if (is_question(frame.type)) {
+        asked = true;
+      }
+
+      if (done) {
+        break;
+      }
+    }
+
+    if (done) {
+      break;
+    }
+
+    /* over without a word on who won, it would be stepped in vain until
+       `replay_step_limit' otherwise. */
+    if (process_flags & process_end) {
+      verdict.outcome = replay_ended;
+      break;
+    }
+
+    if (asked) {
+      if (verdict.consumed == verdict.total) {
+        verdict.outcome = replay_exhausted;
+        break;
+      }
+
+      auto const from = responses.offsets[verdict.consumed];
+      auto const to   = responses.offsets[verdict.consumed + 1];
+
+      byte response_buffer[64] = { };
+      std::memcpy(response_buffer, responses.data.data() + from, to - from);
+      api->set_responseb(duel, response_buffer);
+
+      ++verdict.consumed;
+      idle = 0;
+    }
+  }
+
+  end_duel(duel);
+}
+
+/**
+ * reads a js array of numbers into `codes', false (and throws) if it is not
+ * one.
+ */
+static
+bool read_codes(Napi::Env env, Napi::Value value, std::vector<std::uint32_t> &codes)
+{
+  if (!value.IsArray()) {
+    Napi::TypeError::New(env, "Error: Array expected").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  auto array = value.As<Napi::Array>();
+  codes.resize(array.Length());
+  for (std::uint32_t i = 0; i != array.Length(); ++i) {
+    auto const code = array.Get(i);
+    if (!code.IsNumber()) {
+      Napi::TypeError::New(env, "Error: Integer expected").ThrowAsJavaScriptException();
+      return false;
+    }
+    codes[i] = code.As<Napi::Number>().Uint32Value();
+  }
+
+  return true;
+}
+
+/**
+ * reads `[{ seed, lp, start, draw, options, players, responses, offsets? },
+ * ...]' into `jobs', `players' being two `{ main, extra }'. `responses' are
+ * packed as in a replay file, or split by `offsets' as `readReplay' hands
+ * them out. false (and throws) on anything else.
+ */
+static
+bool read_replays( Napi::Env               env
+                 , Napi::Array             replays
+                 , std::vector<ReplayJob> &jobs)
+{
+  jobs.resize(replays.Length());
+
+  for (std::uint32_t i = 0; i != replays.Length(); ++i) {
+    auto  value = replays.Get(i);
+    auto &setup = jobs[i].setup;
+
+    if (!value.IsObject()) {
+      Napi::TypeError::New(env, "Error: Object expected").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    auto replay = value.As<Napi::Object>();
+    GET_INTEGER_PROPERTY(replay, seed,    Uint32);
+    GET_INTEGER_PROPERTY(replay, lp,      Int32);
+    GET_INTEGER_PROPERTY(replay, start,   Int32);
+    GET_INTEGER_PROPERTY(replay, draw,    Int32);
+    GET_INTEGER_PROPERTY(replay, options, Int32);
+    if (env.IsExceptionPending()) {
+      return false;
+    }
+
+    setup.seed    = seed;
+    setup.lp      = lp;
+    setup.start   = start;
+    setup.draw    = draw;
+    setup.options = options;
+
+    auto const players = replay.Get("players");
+    if (!players.IsArray() || players.As<Napi::Array>().Length() != 2) {
+      Napi::TypeError::New(env, "Error: two players expected").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    for (std::uint32_t player = 0; player != 2; ++player) {
+      auto const deck = players.As<Napi::Array>().Get(player);
+      if (!deck.IsObject()
+          || !read_codes(env, deck.As<Napi::Object>().Get("main"),  setup.decks[player].main)
+          || !read_codes(env, deck.As<Napi::Object>().Get("extra"), setup.decks[player].extra)) {
+        if (!env.IsExceptionPending()) {
+          Napi::TypeError::New(env, "Error: Object expected").ThrowAsJavaScriptException();
+        }
+        return false;
+      }
+    }
+
+    byte const  *data   = nullptr;
+    std::size_t  length = 0;
+    if (!view_bytes(replay.Get("responses"), data, length)) {
+      Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    byte const  *offsets        = nullptr;
+    std::size_t  offsets_length = 0;
+    auto const   offsets_value  = replay.Get("offsets");
+    if (!offsets_value.IsUndefined() && !view_bytes(offsets_value, offsets, offsets_length)) {
+      Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    auto offset_table = std::vector<std::uint32_t>(offsets_length / sizeof(std::uint32_t));
+    if (offsets) {
+      std::memcpy(offset_table.data(), offsets, offset_table.size() * sizeof(std::uint32_t));
+    }
+
+    if (offsets
+        ? !split_responses(data, length, offset_table.data(), offset_table.size(), jobs[i].responses)
+        : !unpack_responses(data, length, jobs[i].responses)) {
+      Napi::RangeError::New(env, "Error: malformed responses in replay #" + std::to_string(i)).ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * one `ReplayVerdict' per replay, in order, 6 u32 each.
+ */
+static
+Napi::ArrayBuffer wrap_verdicts(Napi::Env env, std::vector<ReplayJob> const &jobs)
+{
+  auto const size     = jobs.size() * sizeof(ReplayVerdict);
+  auto       verdicts = new byte[size];
+  for (std::size_t i = 0; i != jobs.size(); ++i) {
+    std::memcpy(verdicts + i * sizeof(ReplayVerdict), &jobs[i].verdict, sizeof(ReplayVerdict));
+  }
+
+  return Napi::ArrayBuffer::New(env, verdicts, size, finalizer);
+}
+
+/**
+ * `verifyReplays(replays, threads)': plays each replay through in a duel of
+ * its own (not visible to js), feeding its responses whenever ocgcore asks,
+ * on up to `threads' threads. returns the verdicts, see `wrap_verdicts'.
+ */
+Napi::Value CoreEngine::verifyReplays(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  GET_ARG_OF_TYPE(info, 0, Array);
+  CHECK_INT(1, threads, Uint32Value);
+
+  if (threads > 1 && !require_frozen_stores(env)) {
+    return Napi::Value();
+  }
+
+  auto jobs = std::vector<ReplayJob>();
+  if (!read_replays(env, arg0, jobs)) {
+    return Napi::Value();
+  }
+
+  auto const engine_context = context();
+  ThreadPool::shared().parallel_for(jobs.size(), threads, [&](std::size_t i) { verify_replay(engine_context, jobs[i]); });
+
+  return wrap_verdicts(env, jobs);
+}
+
+/**
+ * `verifyReplays' off the main thread, settles a promise of the verdicts.
+ */
+struct CoreEngine::ReplayWorker : public Napi::AsyncWorker
+{
+  CoreEngine              *engine;
+  EngineContext const      context;
+  std::vector<ReplayJob>   jobs;
+  std::uint32_t            threads;
+  Napi::Promise::Deferred  deferred;
+
+  ReplayWorker( Napi::Env                env
+              , CoreEngine              *engine
+              , std::vector<ReplayJob> &&jobs
+              , std::uint32_t            threads)
+    : Napi::AsyncWorker(env)
+    , engine(engine)
+    , context(engine->context())
+    , jobs(std::move(jobs))
+    , threads(threads)
+    , deferred(Napi::Promise::Deferred::New(env))
+  {
+    engine->hold_for_worker();
+  }
+
+  void Execute() override
+  {
+    ThreadPool::shared().parallel_for(jobs.size(), threads, [&](std::size_t i) { engine->verify_replay(context, jobs[i]); });
+  }
+
+  void OnOK() override
+  {
+    auto env   = Env();
+    auto scope = Napi::HandleScope(env);
+
+    engine->release_from_worker();
+    deferred.Resolve(wrap_verdicts(env, jobs));
+  }
+
+  void OnError(Napi::Error const &error) override
+  {
+    engine->release_from_worker();
+    deferred.Reject(error.Value());
+  }
+};
+
+Napi::Value CoreEngine::verifyReplaysAsync(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  GET_ARG_OF_TYPE(info, 0, Array);
+  CHECK_INT(1, threads, Uint32Value);
+
+  if (!require_frozen_stores(env)) {
+    return Napi::Value();
+  }
+
+  auto jobs = std::vector<ReplayJob>();
+  if (!read_replays(env, arg0, jobs)) {
+    return Napi::Value();
+  }
+
+  auto worker  = new ReplayWorker(env, this, std::move(jobs), threads);
+  auto promise = worker->deferred.Promise();
+  worker->Queue(); // deletes itself once settled.
+
+  return promise;
+}
+
+/**
+ * `{ processCalls, ..., process: { count, mean, max, p50, ... }, ... }',
+ * latencies in nanoseconds. see `StatsCounter' / `StatsTimer' for keys.
+ */
+static
+Napi::Object wrap_stats(Napi::Env env, StatsTotals const &totals)
+{
+  auto result = Napi::Object::New(env);
+
+  for (std::uint32_t i = 0; i != stat_counter_count; ++i) {
+    result.Set(counter_name(StatsCounter(i)), Napi::Value::From(env, double(totals.counters[i])));
+  }
+
+  for (std::uint32_t i = 0; i != timer_count; ++i) {
+    auto const &timer = totals.timers[i];
+    auto        latency = Napi::Object::New(env);
+
+    latency.Set("count", Napi::Value::From(env, double(timer.count)));
+    latency.Set("mean",  Napi::Value::From(env, timer.count ? double(timer.sum) / timer.count : 0.0));
+    latency.Set("max",   Napi::Value::From(env, double(timer.max)));
+    latency.Set("p50",   Napi::Value::From(env, double(timer.percentile(0.5))));
+    latency.Set("p90",   Napi::Value::From(env, double(timer.percentile(0.9))));
+    latency.Set("p99",   Napi::Value::From(env, double(timer.percentile(0.99))));
+    latency.Set("p999",  Napi::Value::From(env, double(timer.percentile(0.999))));
+
+    result.Set(timer_name(StatsTimer(i)), latency);
+  }
+
+  return result;
+}
+
+/**
+ * `stats()': counters and latencies of every duel this engine ran (ended
+ * ones included) and of what it did outside of any duel. `stats(duel)':
+ * those of one duel, busy or not.
+ */
+Napi::Value CoreEngine::stats(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  auto totals = std::make_unique<StatsTotals>();
+
+  if (info.Length() > 0) {
+    GET_ARG_OF_TYPE(info, 0, Number);
+    auto const instance = wrapper->find(arg0.Uint32Value());
+    if (!instance) {
+      throw_unknown_duel(env, arg0.Uint32Value());
+      return Napi::Value();
+    }
+    totals->add(*instance->stats);
+    return wrap_stats(env, *totals);
+  }
+
+  totals->add(*retired_stats);
+  totals->add(*engine_stats);
+  for (auto const &slot: wrapper->slots) {
+    if (slot.live) {
+      totals->add(*slot.instance.stats);
+    }
+  }
+
+  return wrap_stats(env, *totals);
+}
+
+/**
+ * `setLogPolicy({ sampleEvery?, rate?, burst? })', see `LogPolicy'. steps
+ * already running keep the policy they started with.
+ */
+Napi::Value CoreEngine::setLogPolicy(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, Object);
+
+  auto policy = log_policy;
+  for (auto const &[key, field]: { std::make_pair("sampleEvery", &policy.sample_every)
+                                 , std::make_pair("rate",        &policy.rate)
+                                 , std::make_pair("burst",       &policy.burst) }) {
+    auto const value = arg0.Get(key);
+    if (value.IsUndefined()) {
+      continue;
+    }
+    REQUIRE_OF_TYPE(value, Number);
+    *field = value.As<Napi::Number>().Uint32Value();
+  }
+
+  log_policy = policy;
+  return Napi::Value();
+}
+
+/**
+ * moves what is pending in `ring' to `messages', tagged with `duel'.
+ */
+static
+void drain_ring( Napi::Env           env
+               , duel_instance_id_t  duel
+               , LogRing            &ring
+               , Napi::Array        &messages
+               , double             &dropped
+               , double             &suppressed)
+{
+  ring.drain([&](LogEntry const &entry) {
+    auto message = Napi::Object::New(env);
+    message.Set("duel", Napi::Value::From(env, duel));
+    message.Set("type", Napi::Value::From(env, entry.type));
+    message.Set("time", Napi::Value::From(env, double(entry.time) / 1e6));
+    message.Set("text", Napi::String::New(env, entry.text, entry.length));
+    messages.Set(messages.Length(), message);
+  });
+
+  dropped    += ring.take_dropped();
+  suppressed += ring.take_suppressed();
+}
+
+/**
+ * `drainLog(duel?)': `{ messages: [{ duel, type, time, text }], dropped,
+ * suppressed }', what ocgcore logged for the duel (or for every duel) since
+ * the last drain, oldest first, `time' in milliseconds (steady clock).
+ * busy duels may be drained too. a duel's messages go with it once it
+ * ends.
+ */
+Napi::Value CoreEngine::drainLog(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  auto   messages   = Napi::Array::New(env);
+  double dropped    = 0;
+  double suppressed = 0;
+
+  if (info.Length() > 0) {
+    GET_ARG_OF_TYPE(info, 0, Number);
+    auto const instance = wrapper->find(arg0.Uint32Value());
+    if (!instance) {
+      throw_unknown_duel(env, arg0.Uint32Value());
+      return Napi::Value();
+    }
+    drain_ring(env, arg0.Uint32Value(), *instance->log, messages, dropped, suppressed);
+  } else {
+    for (std::uint32_t index = 0; index != wrapper->slots.size(); ++index) {
+      auto &slot = wrapper->slots[index];
+      if (slot.live) {
+        auto const id = slot.generation << Wrapper::index_bits | index;
+        drain_ring(env, id, *slot.instance.log, messages, dropped, suppressed);
+      }
+    }
+  }
+
+  auto result = Napi::Object::New(env);
+  result.Set("messages",   messages);
+  result.Set("dropped",    Napi::Value::From(env, dropped));
+  result.Set("suppressed", Napi::Value::From(env, suppressed));
+
+  return result;
+}
+
+/**
+ * more spans than this per duel is taken as a mistake (64 MiB).
+ */
+static constexpr std::uint32_t trace_capacity_limit = 1u << 20;
+
+/**
+ * `setTracing({ capacity, markers? })': from now on every duel keeps its
+ * last `capacity' spans (process calls, queries, responses, script and card
+ * reads), 0 turns tracing off. duels that are not busy start over, busy
+ * ones keep what they had. `markers' also writes each span to ftrace's
+ * `trace_marker' (see `enable_trace_markers'), throws if that can not be
+ * opened.
+ */
+Napi::Value CoreEngine::setTracing(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, Object);
+  GET_INTEGER_PROPERTY(arg0, capacity, Uint32);
+
+  if (capacity > trace_capacity_limit) {
+    Napi::RangeError::New(env, "trace capacity is too large").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto const markers = arg0.Get("markers");
+  if (markers.IsBoolean() && markers.As<Napi::Boolean>().Value() && capacity) {
+    if (!enable_trace_markers()) {
+      Napi::Error::New(env, "Error: trace_marker is not writable").ThrowAsJavaScriptException();
+      return Napi::Value();
+    }
+  } else {
+    disable_trace_markers();
+  }
+
+  trace_capacity = capacity;
+  for (auto &slot: wrapper->slots) {
+    if (slot.live && !slot.instance.busy) {
+      slot.instance.trace = capacity ? std::make_unique<TraceBuffer>(capacity) : nullptr;
+    }
+  }
+
+  return Napi::Value();
+}
+
+/**
+ * `exportTrace(duel?)': the spans of the duel (or of every duel not busy)
+ * as chrome trace-event json, one thread per duel, for `chrome://tracing'
+ * or perfetto. spans are kept, not drained.
+ */
+Napi::Value CoreEngine::exportTrace(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  auto const pid         = std::uint32_t(uv_os_getpid());
+  auto       json        = std::string("{\"traceEvents\":[");
+  auto       first       = true;
+  auto       overwritten = std::uint64_t(0);
+
+  auto append = [&](duel_instance_id_t id, TraceBuffer const &trace) {
+    char thread_name[128];
+    std::snprintf( thread_name
+                 , sizeof thread_name
+                 , "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"duel %u\"}}"
+                 , first ? "" : ","
+                 , pid
+                 , id
+                 , id);
+    json += thread_name;
+    first = false;
+
+    trace.append_json(json, pid, id, first);
+    overwritten += trace.overwritten();
+  };
+
+  if (info.Length() > 0) {
+    CHECK_DUEL(0);
+    if (instance->trace) {
+      append(duel_id, *instance->trace);
+    }
+  } else {
+    for (std::uint32_t index = 0; index != wrapper->slots.size(); ++index) {
+      auto const &slot = wrapper->slots[index];
+      if (slot.live && !slot.instance.busy && slot.instance.trace) {
+        append(slot.generation << Wrapper::index_bits | index, *slot.instance.trace);
+      }
+    }
+  }
+
+  json += "],\"otherData\":{\"overwritten\":" + std::to_string(overwritten) + "}}";
+
+  return Napi::String::New(env, json);
 }
 
 #define NOT_IMPLEMENTED(x)                                                                 \
@@ -514,6 +2558,12 @@ Napi::Function CoreEngine::initialize(Napi::Env &env)
                                         , METHOD(  setPlayerInfo)
                                         , METHOD(  getLogMessage)
                                         , METHOD(        process)
+                                        , METHOD(   processAsync)
+                                        , METHOD(runUntilDecision)
+                                        , METHOD(   indexMessages)
+                                        , METHOD(      splitViews)
+                                        , METHOD(        stepMany)
+                                        , METHOD(   stepManyAsync)
                                         , METHOD(        newCard)
                                         , METHOD(     newTagCard)
                                         , METHOD(      queryCard)
@@ -522,6 +2572,23 @@ Napi::Function CoreEngine::initialize(Napi::Env &env)
                                         , METHOD( queryFieldInfo)
                                         , METHOD(    setResponse)
                                         , METHOD(  preloadScript)
+                                        , METHOD(     messageBuffer)
+                                        , METHOD(       queryBuffer)
+                                        , METHOD(       processInto)
+                                        , METHOD(     pendingBuffer)
+                                        , METHOD(     queryCardInto)
+                                        , METHOD(queryFieldCardInto)
+                                        , METHOD(      refreshBatch)
+                                        , METHOD(   snapshotDuel)
+                                        , METHOD(    restoreDuel)
+                                        , METHOD(       forkDuel)
+                                        , METHOD(     verifyReplays)
+                                        , METHOD(verifyReplaysAsync)
+                                        , METHOD(          stats)
+                                        , METHOD(   setLogPolicy)
+                                        , METHOD(       drainLog)
+                                        , METHOD(     setTracing)
+                                        , METHOD(    exportTrace)
                                         , METHOD(       bindData)
                                         , METHOD(     bindScript)
                                         }
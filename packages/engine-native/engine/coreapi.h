@@ -1,8 +1,11 @@
 #pragma once
 
+#include "messages.h"
+#include "logring.h"
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 #include <napi.h>
 
 namespace ny {
@@ -17,6 +20,13 @@ using byte = unsigned char;
  */
 using duel_ptr_t = long;
 
+/**
+ * taken from ocgcore, `process' returns these above the message length
+ * (PROCESSOR_WAITING, PROCESSOR_END shifted down).
+ */
+constexpr std::int32_t process_waiting = 1;
+constexpr std::int32_t process_end     = 2;
+
 extern "C" {
 
 #define DEFINE_API_PROTOTYPE(name, ret, ...) typedef ret (* name##_t)(__VA_ARGS__)
@@ -164,11 +174,43 @@ DEFINE_API_SLOT(set_message_handler);
 
 class DataStore;
 class ScriptStore;
+struct BatchItem;
+struct DuelInstance;
+struct JournalEntry;
+class DuelJournal;
+struct ReplayJob;
+struct Stats;
+struct StatsTotals;
+
+using duel_instance_id_t = std::uint32_t;
+
+/**
+ * what ocgcore's card / script readers see, installed per thread for the
+ * duration of each API call (see `ContextScope').
+ */
+struct EngineContext
+{
+  DataStore   const *data_store   = nullptr;
+  ScriptStore const *script_store = nullptr;
+
+  /**
+   * the engine's own, for reads made outside of any duel.
+   */
+  Stats             *stats        = nullptr;
+
+  /**
+   * applied by whoever steps a duel, see `CoreEngine::setLogPolicy'.
+   */
+  LogPolicy          log_policy;
+};
 
 class CoreEngine : public Napi::ObjectWrap<CoreEngine>
 {
 public:
   struct Wrapper;
+  struct ProcessWorker;
+  struct BatchWorker;
+  struct ReplayWorker;
 
 private:
   std::unique_ptr<Wrapper>  wrapper;
@@ -177,12 +219,107 @@ private:
   DataStore                *data_store   = nullptr;
   ScriptStore              *script_store = nullptr;
 
+  /**
+   * keep the bound stores alive for as long as they are bound.
+   */
+  Napi::ObjectReference     data_store_ref;
+  Napi::ObjectReference     script_store_ref;
+
+  /**
+   * workers that have not settled yet, they run on a copy of `context()',
+   * stores can not be rebound until they are done.
+   */
+  std::uint32_t             running_workers = 0;
+
+  /**
+   * see `stats', what ended duels left behind is added up in `retired_stats'.
+   */
+  std::unique_ptr<Stats>        engine_stats;
+  std::unique_ptr<StatsTotals>  retired_stats;
+
+  LogPolicy                     log_policy;
+
+  /**
+   * spans kept per duel, 0 while tracing is off, see `setTracing'.
+   */
+  std::size_t                   trace_capacity = 0;
+
 public:
   CoreEngine(Napi::CallbackInfo const &info);
 
   DataStore   const *get_data_store()   const;
   ScriptStore const *get_script_store() const;
 
+  /**
+   * snapshot of the current bindings, taken on the main thread.
+   */
+  EngineContext context() const;
+
+private:
+  /**
+   * ocgcore's create_duel / end_duel, behind one lock shared by every
+   * engine: both update ocgcore's global `duel_set' (a std::set) unguarded,
+   * and workers (`verifyReplays') create and end duels of their own. calls
+   * on a single duel (process, get_message, queries, ...) run unlocked.
+   */
+  duel_ptr_t create_duel(std::uint32_t seed);
+  void       end_duel(duel_ptr_t duel);
+
+  /**
+   * worker threads read the bound stores while js keeps running, false
+   * (and throws) unless both are frozen (or not bound at all).
+   */
+  bool require_frozen_stores(Napi::Env env) const;
+
+  /**
+   * taken by every worker on the main thread before it is queued, and
+   * given back once it settled: keeps the engine alive and the stores bound.
+   */
+  void hold_for_worker();
+  void release_from_worker();
+
+  /**
+   * runs one ocgcore step and fetches its messages into `message_buffer'
+   * (at least 0x1000 bytes). safe to call off the main thread as long as
+   * no one else is touching the duel.
+   */
+  std::int32_t step( EngineContext const &context
+                   , DuelInstance        &instance
+                   , byte                *message_buffer);
+
+  /**
+   * steps a duel until it needs a decision, or until a step emits one of
+   * `stop_after'. its messages go to the duel's `pending' buffer and their
+   * frames to `frames'. returns the flags of the last step.
+   */
+  std::int32_t run_until_decision( EngineContext  const &context
+                                 , DuelInstance         &instance
+                                 , MessageTypeSet const &stop_after = MessageTypeSet());
+
+  /**
+   * sets responses and runs `run_until_decision' for every duel in `items',
+   * spread over `threads' threads (the calling one included).
+   */
+  void run_batch( EngineContext const    &context
+                , std::vector<BatchItem> &items
+                , std::uint32_t           threads);
+
+  /**
+   * a new duel that went through `entries', see `DuelJournal'. returns 0
+   * (and throws) if it could not be created.
+   */
+  duel_instance_id_t replay_journal( Napi::Env                        env
+                                   , DuelJournal const               &journal
+                                   , std::vector<JournalEntry> const &entries);
+
+  /**
+   * plays a replay through in a duel of its own, fills in its verdict. safe
+   * to call off the main thread: the duel is created and ended under
+   * `create_duel's lock, only setting it up and process / get_message run
+   * unlocked.
+   */
+  void verify_replay(EngineContext const &context, ReplayJob &job);
+
 public:
   Napi::Value      createDuel(Napi::CallbackInfo const &info);
   Napi::Value       startDuel(Napi::CallbackInfo const &info);
@@ -190,6 +327,12 @@ public:
   Napi::Value   setPlayerInfo(Napi::CallbackInfo const &info);
   Napi::Value   getLogMessage(Napi::CallbackInfo const &info);
   Napi::Value         process(Napi::CallbackInfo const &info);
+  Napi::Value    processAsync(Napi::CallbackInfo const &info);
+  Napi::Value runUntilDecision(Napi::CallbackInfo const &info);
+  Napi::Value    indexMessages(Napi::CallbackInfo const &info);
+  Napi::Value       splitViews(Napi::CallbackInfo const &info);
+  Napi::Value         stepMany(Napi::CallbackInfo const &info);
+  Napi::Value    stepManyAsync(Napi::CallbackInfo const &info);
   Napi::Value         newCard(Napi::CallbackInfo const &info);
   Napi::Value      newTagCard(Napi::CallbackInfo const &info);
   Napi::Value       queryCard(Napi::CallbackInfo const &info);
@@ -198,6 +341,32 @@ public:
   Napi::Value  queryFieldInfo(Napi::CallbackInfo const &info);
   Napi::Value     setResponse(Napi::CallbackInfo const &info);
   Napi::Value   preloadScript(Napi::CallbackInfo const &info);
+  Napi::Value    snapshotDuel(Napi::CallbackInfo const &info);
+  Napi::Value     restoreDuel(Napi::CallbackInfo const &info);
+  Napi::Value        forkDuel(Napi::CallbackInfo const &info);
+  Napi::Value   verifyReplays(Napi::CallbackInfo const &info);
+  Napi::Value verifyReplaysAsync(Napi::CallbackInfo const &info);
+
+public:
+  /**
+   * allocation free variants, results go to the duel's own buffers.
+   */
+  Napi::Value       messageBuffer(Napi::CallbackInfo const &info);
+  Napi::Value         queryBuffer(Napi::CallbackInfo const &info);
+  Napi::Value         processInto(Napi::CallbackInfo const &info);
+  Napi::Value       pendingBuffer(Napi::CallbackInfo const &info);
+  Napi::Value       queryCardInto(Napi::CallbackInfo const &info);
+  Napi::Value  queryFieldCardInto(Napi::CallbackInfo const &info);
+  Napi::Value        refreshBatch(Napi::CallbackInfo const &info);
+
+public:
+  Napi::Value stats(Napi::CallbackInfo const &info);
+
+public:
+  Napi::Value setLogPolicy(Napi::CallbackInfo const &info);
+  Napi::Value     drainLog(Napi::CallbackInfo const &info);
+  Napi::Value   setTracing(Napi::CallbackInfo const &info);
+  Napi::Value  exportTrace(Napi::CallbackInfo const &info);
 
 public:
   Napi::Value bindData(Napi::CallbackInfo const &info);
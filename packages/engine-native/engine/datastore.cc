@@ -1,8 +1,19 @@
 #include "datastore.h"
+#include "cdb.h"
 #include "misc.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace ny {
 
+DataStore::DataStore(Napi::CallbackInfo const &info)
+  : Napi::ObjectWrap<DataStore>(info)
+{ }
+
+DataStore::~DataStore() = default;
+
 Napi::Value DataStore::add(const Napi::CallbackInfo &info)
 {
   auto env   = info.Env();
@@ -11,6 +22,11 @@ Napi::Value DataStore::add(const Napi::CallbackInfo &info)
   REQUIRE_N_ARGS(info, 1);
   GET_ARG_OF_TYPE(info, 0, Object);
 
+  if (by_code.is_frozen()) {
+    Napi::Error::New(env, "Error: DataStore is frozen").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
   GET_INTEGER_PROPERTY(arg0, code,        Uint32);
   GET_INTEGER_PROPERTY(arg0, alias,       Uint32);
   GET_INTEGER_PROPERTY(arg0, type,        Uint32);
@@ -43,9 +59,54 @@ Napi::Value DataStore::add(const Napi::CallbackInfo &info)
   record.rscale      = rscale;
   record.link_marker =link_marker;
 
-  auto status = by_code.insert(std::make_pair(code, record));
+  return Napi::Boolean::New(env, by_code.insert(record));
+}
+
+/**
+ * bulk load, takes an ArrayBuffer (or a view of one) of packed `Record's.
+ * returns the number of records actually added (duplicates are skipped).
+ */
+Napi::Value DataStore::addMany(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+
+  if (by_code.is_frozen()) {
+    Napi::Error::New(env, "Error: DataStore is frozen").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  std::uint8_t const  *data   = nullptr;
+  std::size_t  length = 0;
+
+  if (info[0].IsTypedArray()) {
+    auto view = info[0].As<Napi::TypedArray>();
+    data   = static_cast<std::uint8_t const *>(view.ArrayBuffer().Data()) + view.ByteOffset();
+    length = view.ByteLength();
+  } else if (info[0].IsArrayBuffer()) {
+    auto buffer = info[0].As<Napi::ArrayBuffer>();
+    data   = static_cast<std::uint8_t const *>(buffer.Data());
+    length = buffer.ByteLength();
+  } else {
+    Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  if (length % sizeof(Record)) {
+    Napi::RangeError::New(env, "Error: buffer length is not a multiple of the record size").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  std::uint32_t added = 0;
+  for (std::size_t offset = 0; offset != length; offset += sizeof(Record)) {
+    Record record;
+    std::memcpy(&record, data + offset, sizeof record);
+    added += by_code.insert(record);
+  }
 
-  return Napi::Boolean::New(env, status.second);
+  return Napi::Value::From(env, added);
 }
 
 Napi::Value DataStore::get(Napi::CallbackInfo const &info)
@@ -59,11 +120,11 @@ Napi::Value DataStore::get(Napi::CallbackInfo const &info)
   auto code = arg0.Uint32Value();
 
   auto found = by_code.find(code);
-  if (found == by_code.end()) {
+  if (!found) {
     return Napi::Value();
   }
 
-  auto const &record = found->second;
+  auto const &record = *found;
   auto card          = Napi::Object::New(env);
 
   card.Set("code",        record.code);
@@ -88,16 +149,140 @@ Napi::Value DataStore::keys(Napi::CallbackInfo const &info)
   auto env   = info.Env();
   auto scope = Napi::HandleScope(env);
 
-  auto keys = Napi::Array::New(env);
-  for (auto const &pair: by_code) {
-    keys.Set(keys.Length(), pair.first);
+  std::vector<std::uint32_t> codes;
+  codes.reserve(by_code.size());
+  for (auto const &record: by_code) {
+    codes.push_back(record.code);
+  }
+  if (!by_code.is_frozen()) {
+    std::sort(codes.begin(), codes.end());
+  }
+
+  auto keys = Napi::Array::New(env, codes.size());
+  for (std::uint32_t i = 0; i != codes.size(); ++i) {
+    keys.Set(i, codes[i]);
   }
 
   return keys;
 }
 
+/**
+ * sort the table into its read-optimized layout. no more `add' after this.
+ */
+Napi::Value DataStore::freeze(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  by_code.freeze();
+
+  return Napi::Value();
+}
+
+/**
+ * load the `datas' table of a cards.cdb natively, texts are left in the
+ * database and read on demand by `text'.
+ */
+Napi::Value DataStore::loadCdb(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, String);
+
+  if (by_code.is_frozen()) {
+    Napi::Error::New(env, "Error: DataStore is frozen").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto path  = arg0.Utf8Value();
+  auto error = std::string();
+  auto added = load_cdb(path, by_code, error);
+  if (added < 0) {
+    Napi::Error::New(env, "Error: loadCdb: " + error).ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  texts = std::make_unique<CdbTexts>(path);
+
+  return Napi::Value::From(env, added);
+}
+
+Napi::Value DataStore::text(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, Number);
+
+  CardText card_text;
+  if (!texts || !texts->read(arg0.Uint32Value(), card_text)) {
+    return Napi::Value();
+  }
+
+  auto strings = Napi::Array::New(env, card_text.strings.size());
+  for (std::uint32_t i = 0; i != card_text.strings.size(); ++i) {
+    strings.Set(i, card_text.strings[i]);
+  }
+
+  auto object = Napi::Object::New(env);
+  object.Set("name",        card_text.name);
+  object.Set("description", card_text.description);
+  object.Set("texts",       strings);
+
+  return object;
+}
+
+/**
+ * freeze, then write the card table as a snapshot (see snapshot.h).
+ */
+Napi::Value DataStore::saveSnapshot(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, String);
+
+  by_code.freeze();
+
+  auto error = std::string();
+  if (!write_snapshot(arg0.Utf8Value(), by_code, error)) {
+    Napi::Error::New(env, "Error: saveSnapshot: " + error).ThrowAsJavaScriptException();
+  }
+
+  return Napi::Value();
+}
+
+/**
+ * map a snapshot read-only, the store must still be empty. the store is
+ * frozen afterwards.
+ */
+Napi::Value DataStore::loadSnapshot(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, String);
+
+  if (by_code.is_frozen() || by_code.size()) {
+    Napi::Error::New(env, "Error: loadSnapshot: DataStore is not empty").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto error = std::string();
+  if (!open_snapshot(arg0.Utf8Value(), by_code, error)) {
+    Napi::Error::New(env, "Error: loadSnapshot: " + error).ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  return Napi::Value::From(env, static_cast<std::uint32_t>(by_code.size()));
+}
 
-std::map<std::uint32_t, Record> const &DataStore::records() const
+CardIndex const &DataStore::records() const
 {
   return by_code;
 }
@@ -109,8 +294,14 @@ Napi::Function DataStore::initialize(Napi::Env &env)
   auto klass = DataStore::DefineClass( env
                                      , "DataStore"
                                      , { DataStore::InstanceMethod("add", &DataStore::add)
+                                       , DataStore::InstanceMethod("addMany", &DataStore::addMany)
                                        , DataStore::InstanceMethod("get", &DataStore::get)
                                        , DataStore::InstanceMethod("keys", &DataStore::keys)
+                                       , DataStore::InstanceMethod("freeze", &DataStore::freeze)
+                                       , DataStore::InstanceMethod("loadCdb", &DataStore::loadCdb)
+                                       , DataStore::InstanceMethod("text", &DataStore::text)
+                                       , DataStore::InstanceMethod("saveSnapshot", &DataStore::saveSnapshot)
+                                       , DataStore::InstanceMethod("loadSnapshot", &DataStore::loadSnapshot)
                                        }
                                      );
   DataStore::constructor = Napi::Persistent(klass);
@@ -0,0 +1,207 @@
+#include "journal.h"
+#include "checksum.h"
+#include <cstring>
+
+namespace ny {
+
+namespace {
+
+template <typename T>
+void put(std::vector<std::uint8_t> &ops, T value)
+{
+  auto const offset = ops.size();
+  ops.resize(offset + sizeof value);
+  std::memcpy(ops.data() + offset, &value, sizeof value);
+}
+
+/**
+ * reads host order integers off the ops, any read past `end' poisons it.
+ */
+struct OpReader
+{
+  std::uint8_t const *at;
+  std::uint8_t const *end;
+  bool                ok = true;
+
+  template <typename T>
+  T next()
+  {
+    T value = 0;
+    if (!ok || std::size_t(end - at) < sizeof value) {
+      ok = false;
+      return value;
+    }
+    std::memcpy(&value, at, sizeof value);
+    at += sizeof value;
+    return value;
+  }
+};
+
+} // namespace
+
+void DuelJournal::create(std::uint32_t seed)
+{
+  ops.push_back(journal_create);
+  put(ops, seed);
+}
+
+void DuelJournal::player_info(std::int32_t player, std::int32_t lp, std::int32_t start, std::int32_t draw)
+{
+  ops.push_back(journal_player_info);
+  put(ops, player);
+  put(ops, lp);
+  put(ops, start);
+  put(ops, draw);
+}
+
+void DuelJournal::new_card( std::uint32_t code
+                          , std::uint8_t  owner
+                          , std::uint8_t  player
+                          , std::uint8_t  location
+                          , std::uint8_t  sequence
+                          , std::uint8_t  position)
+{
+  ops.push_back(journal_new_card);
+  put(ops, code);
+  put(ops, owner);
+  put(ops, player);
+  put(ops, location);
+  put(ops, sequence);
+  put(ops, position);
+}
+
+void DuelJournal::start(std::int32_t options)
+{
+  ops.push_back(journal_start);
+  put(ops, options);
+}
+
+void DuelJournal::response(std::uint8_t const *data, std::size_t length)
+{
+  if (length > journal_max_response) {
+    length = journal_max_response;
+  }
+
+  ops.push_back(journal_response);
+  put(ops, steps);
+  put(ops, std::uint8_t(length));
+  ops.insert(ops.end(), data, data + length);
+
+  steps = 0;
+}
+
+std::vector<std::uint8_t> DuelJournal::serialize() const
+{
+  std::vector<std::uint8_t> image(sizeof(JournalHeader) + ops.size());
+
+  JournalHeader header;
+  std::memcpy(header.magic, journal_magic, sizeof header.magic);
+  header.version        = journal_version;
+  header.trailing_steps = steps;
+  header.checksum       = checksum(ops.data(), ops.size());
+  std::memcpy(image.data(), &header, sizeof header);
+
+  if (!ops.empty()) {
+    std::memcpy(image.data() + sizeof header, ops.data(), ops.size());
+  }
+
+  return image;
+}
+
+bool DuelJournal::load( std::uint8_t const        *data
+                      , std::size_t                length
+                      , std::vector<JournalEntry> &entries
+                      , std::string               &error)
+{
+  JournalHeader header;
+  if (length < sizeof header) {
+    error = "truncated duel snapshot";
+    return false;
+  }
+  std::memcpy(&header, data, sizeof header);
+
+  if (std::memcmp(header.magic, journal_magic, sizeof header.magic)) {
+    error = "not a duel snapshot";
+    return false;
+  }
+
+  if (header.version != journal_version) {
+    error = "unsupported duel snapshot version";
+    return false;
+  }
+
+  auto const body        = data + sizeof header;
+  auto const body_length = length - sizeof header;
+  if (checksum(body, body_length) != header.checksum) {
+    error = "corrupted duel snapshot (checksum mismatch)";
+    return false;
+  }
+
+  entries.clear();
+
+  auto reader = OpReader { body, body + body_length };
+  while (reader.ok && reader.at != reader.end) {
+    auto entry = JournalEntry();
+    entry.op = JournalOp(reader.next<std::uint8_t>());
+
+    switch (entry.op) {
+      case journal_create:
+        entry.args[0] = reader.next<std::uint32_t>();
+        break;
+
+      case journal_player_info:
+        for (int i = 0; i != 4; ++i) {
+          entry.args[i] = reader.next<std::int32_t>();
+        }
+        break;
+
+      case journal_new_card:
+        entry.args[0] = reader.next<std::uint32_t>();
+        for (int i = 1; i != 6; ++i) {
+          entry.args[i] = reader.next<std::uint8_t>();
+        }
+        break;
+
+      case journal_start:
+        entry.args[0] = reader.next<std::int32_t>();
+        break;
+
+      case journal_response:
+        entry.args[0]         = reader.next<std::uint32_t>();
+        entry.response_length = reader.next<std::uint8_t>();
+        if (entry.response_length > journal_max_response) {
+          reader.ok = false;
+          break;
+        }
+        for (int i = 0; i != entry.response_length; ++i) {
+          entry.response[i] = reader.next<std::uint8_t>();
+        }
+        break;
+
+      default:
+        reader.ok = false;
+        break;
+    }
+
+    if (reader.ok) {
+      entries.push_back(entry);
+    }
+  }
+
+  if (!reader.ok) {
+    error = "corrupted duel snapshot (bad op)";
+    return false;
+  }
+
+  if (entries.empty() || entries.front().op != journal_create) {
+    error = "corrupted duel snapshot (does not create a duel)";
+    return false;
+  }
+
+  ops.assign(body, body + body_length);
+  steps = header.trailing_steps;
+
+  return true;
+}
+
+} // namespace ny
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ny {
+
+/**
+ * everything that went into a duel, in order: how it was set up, and every
+ * response along with the number of process steps taken before it.
+ *
+ * ocgcore has no way to serialize a running duel (its state lives in a lua
+ * vm), so this is what a duel snapshot is made of; restoring one replays
+ * it into a fresh duel, with the same bindings (cards, scripts).
+ *
+ * serialized:
+ *
+ *   JournalHeader
+ *   ops, back to back, each an op byte followed by its arguments
+ *
+ * integers in host byte order, `checksum' covers the ops.
+ */
+struct JournalHeader
+{
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t trailing_steps;
+  std::uint64_t checksum;
+};
+
+static_assert(sizeof(JournalHeader) == 24, "JournalHeader layout changed");
+
+constexpr char          journal_magic[8] = { 'E', 'G', 'O', 'D', 'U', 'E', 'L', 'J' };
+constexpr std::uint32_t journal_version  = 1;
+
+enum JournalOp : std::uint8_t
+{
+  journal_create      = 1, // u32 seed
+  journal_player_info = 2, // i32 player, lp, start, draw
+  journal_new_card    = 3, // u32 code, u8 owner, player, location, sequence, position
+  journal_start       = 4, // i32 options
+  journal_response    = 5, // u32 steps before, u8 length, length bytes
+};
+
+constexpr std::size_t journal_max_response = 64;
+
+struct JournalEntry
+{
+  JournalOp     op;
+
+  /**
+   * the op's integer arguments in the order listed above, a response only
+   * has `args[0]' (steps before it).
+   */
+  std::int32_t  args[6];
+  std::uint8_t  response_length;
+  std::uint8_t  response[journal_max_response];
+};
+
+class DuelJournal
+{
+  std::vector<std::uint8_t> ops;
+  std::uint32_t             steps = 0;
+
+public:
+  void create(std::uint32_t seed);
+  void player_info(std::int32_t player, std::int32_t lp, std::int32_t start, std::int32_t draw);
+  void new_card( std::uint32_t code
+               , std::uint8_t  owner
+               , std::uint8_t  player
+               , std::uint8_t  location
+               , std::uint8_t  sequence
+               , std::uint8_t  position);
+  void start(std::int32_t options);
+  void response(std::uint8_t const *data, std::size_t length);
+
+  /**
+   * counts one process step.
+   */
+  void step() { ++steps; }
+
+  /**
+   * process steps since the last response.
+   */
+  std::uint32_t trailing_steps() const { return steps; }
+
+  std::vector<std::uint8_t> serialize() const;
+
+  /**
+   * takes over what `serialize' wrote, and decodes its ops into `entries'.
+   */
+  bool load( std::uint8_t const        *data
+           , std::size_t                length
+           , std::vector<JournalEntry> &entries
+           , std::string               &error);
+};
+
+} // namespace ny
@@ -0,0 +1,54 @@
+#include "logring.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace ny {
+
+static constexpr std::uint64_t one_message = 1000000000ull;
+
+void LogRing::push(LogPolicy const &policy, std::uint32_t type, char const *text)
+{
+  auto const now = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+
+  if (policy.sample_every > 1 && seen++ % policy.sample_every) {
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (policy.rate) {
+    auto const cap = std::uint64_t(std::max<std::uint32_t>(policy.burst, 1)) * one_message;
+    if (last_refill == 0) {
+      tokens = cap;
+    } else {
+      tokens = std::min(cap, tokens + (now - last_refill) * policy.rate);
+    }
+    last_refill = now;
+
+    if (tokens < one_message) {
+      suppressed.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    tokens -= one_message;
+  }
+
+  auto const at = head.load(std::memory_order_relaxed);
+  if (at - tail.load(std::memory_order_acquire) == capacity) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto &entry  = entries[at % capacity];
+  entry.time   = now;
+  entry.type   = type;
+  entry.length = text ? strnlen(text, log_text_size - 1) : 0;
+  if (entry.length) {
+    std::memcpy(entry.text, text, entry.length);
+  }
+  entry.text[entry.length] = 0;
+
+  head.store(at + 1, std::memory_order_release);
+}
+
+} // namespace ny
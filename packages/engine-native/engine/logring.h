@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ny {
+
+/**
+ * how much of ocgcore's log output (script errors, `Debug.Message') is
+ * kept, see `LogRing::push'.
+ *
+ * `sample_every': keep one message in that many (1 keeps all).
+ * `rate': messages per second a duel may log once `burst' is used up, 0
+ * for no limit.
+ */
+struct LogPolicy
+{
+  std::uint32_t sample_every = 1;
+  std::uint32_t rate         = 64;
+  std::uint32_t burst        = 32;
+};
+
+/**
+ * ocgcore's `strbuffer' is this large.
+ */
+constexpr std::size_t log_text_size = 256;
+
+struct LogEntry
+{
+  std::uint64_t time;    // steady clock, nanoseconds
+  std::uint32_t type;    // ocgcore's, 1 for script errors, 2 for debug messages
+  std::uint32_t length;
+  char          text[log_text_size];
+};
+
+/**
+ * a duel's log messages, fixed size, single producer (whoever is stepping
+ * the duel) single consumer (js, draining). neither side ever waits, a
+ * message that does not fit is dropped and counted.
+ */
+class LogRing
+{
+public:
+  static constexpr std::uint32_t capacity = 32;
+
+private:
+  LogEntry                   entries[capacity];
+  std::atomic<std::uint64_t> head       = { 0 };
+  std::atomic<std::uint64_t> tail       = { 0 };
+  std::atomic<std::uint64_t> dropped    = { 0 };
+  std::atomic<std::uint64_t> suppressed = { 0 };
+
+  /* producer side only. */
+  std::uint64_t seen        = 0;
+  std::uint64_t tokens      = 0;   // in 1 / 1e9 of a message
+  std::uint64_t last_refill = 0;
+
+public:
+  /**
+   * producer. `text' is cut at `log_text_size - 1' bytes.
+   */
+  void push(LogPolicy const &policy, std::uint32_t type, char const *text);
+
+  /**
+   * consumer. hands each pending entry to `fn', oldest first.
+   */
+  template <typename Fn>
+  std::size_t drain(Fn &&fn)
+  {
+    auto const to   = head.load(std::memory_order_acquire);
+    auto       from = tail.load(std::memory_order_relaxed);
+
+    for (auto at = from; at != to; ++at) {
+      fn(entries[at % capacity]);
+    }
+
+    tail.store(to, std::memory_order_release);
+    return to - from;
+  }
+
+  /**
+   * consumer. messages lost to a full ring / to the policy since last time.
+   */
+  std::uint64_t take_dropped()    { return dropped.exchange(0, std::memory_order_relaxed);    }
+  std::uint64_t take_suppressed() { return suppressed.exchange(0, std::memory_order_relaxed); }
+};
+
+} // namespace ny
@@ -3,6 +3,7 @@
 #include "datastore.h"
 #include "scriptstore.h"
 #include "coreapi.h"
+#include "replayfile.h"
 
 Napi::Object Init(Napi::Env env, Napi::Object exports)
 {
@@ -13,6 +14,7 @@ Napi::Object Init(Napi::Env env, Napi::Object exports)
   exports.Set("DataStore",   DataStore::initialize(env));
   exports.Set("ScriptStore", ScriptStore::initialize(env));
   exports.Set("CoreEngine",  CoreEngine::initialize(env));
+  exports.Set("readReplay",  Napi::Function::New(env, readReplay));
 
   return exports;
 }
@@ -0,0 +1,124 @@
+#include "mappedfile.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace ny {
+
+#ifndef _WIN32
+
+MappedFile::~MappedFile()
+{
+  if (bytes && length) {
+    munmap(const_cast<std::uint8_t *>(bytes), length);
+  }
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(std::string const &path, std::string &error)
+{
+  auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    error = path + ": " + std::strerror(errno);
+    ::close(fd);
+    return nullptr;
+  }
+
+  auto file = std::shared_ptr<MappedFile>(new MappedFile);
+  file->length = static_cast<std::size_t>(st.st_size);
+
+  if (file->length) {
+    auto addr = mmap(nullptr, file->length, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      error = path + ": " + std::strerror(errno);
+      ::close(fd);
+      file->length = 0;
+      return nullptr;
+    }
+    file->bytes = static_cast<std::uint8_t const *>(addr);
+  }
+
+  ::close(fd);
+
+  return file;
+}
+
+#else
+
+MappedFile::~MappedFile()
+{
+  delete []bytes;
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(std::string const &path, std::string &error)
+{
+  auto fp = std::fopen(path.c_str(), "rb");
+  if (!fp) {
+    error = path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+
+  std::fseek(fp, 0, SEEK_END);
+  auto file = std::shared_ptr<MappedFile>(new MappedFile);
+  file->length = static_cast<std::size_t>(std::ftell(fp));
+  std::fseek(fp, 0, SEEK_SET);
+
+  auto bytes = new std::uint8_t[file->length ? file->length : 1];
+  file->bytes = bytes;
+  if (std::fread(bytes, 1, file->length, fp) != file->length) {
+    error = path + ": short read";
+    std::fclose(fp);
+    return nullptr;
+  }
+
+  std::fclose(fp);
+
+  return file;
+}
+
+#endif
+
+bool write_file_atomic( std::string const &path
+                      , void const        *data
+                      , std::size_t        length
+                      , std::string       &error)
+{
+  auto temporary = path + ".tmp";
+  auto fp        = std::fopen(temporary.c_str(), "wb");
+  if (!fp) {
+    error = temporary + ": " + std::strerror(errno);
+    return false;
+  }
+
+  auto written = std::fwrite(data, 1, length, fp);
+  if (std::fclose(fp) != 0 || written != length) {
+    error = temporary + ": write failed";
+    std::remove(temporary.c_str());
+    return false;
+  }
+
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    error = path + ": " + std::strerror(errno);
+    std::remove(temporary.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace ny
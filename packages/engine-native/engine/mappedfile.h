@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ny {
+
+/**
+ * a whole file mapped read-only (read into memory where mmap is not
+ * available). pages are shared between every process mapping the file.
+ */
+class MappedFile
+{
+  std::uint8_t const *bytes  = nullptr;
+  std::size_t         length = 0;
+
+  MappedFile() = default;
+
+public:
+  ~MappedFile();
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator =(MappedFile const &) = delete;
+
+  /**
+   * nullptr (with `error' set) if the file can not be mapped.
+   */
+  static std::shared_ptr<MappedFile> open(std::string const &path, std::string &error);
+
+  std::uint8_t const *data() const { return bytes;  }
+  std::size_t         size() const { return length; }
+};
+
+/**
+ * write `length' bytes to `path' via a temporary file and a rename, so a
+ * file someone else has mapped is never modified in place.
+ */
+bool write_file_atomic( std::string const &path
+                      , void const        *data
+                      , std::size_t        length
+                      , std::string       &error);
+
+} // namespace ny
@@ -0,0 +1,391 @@
+#include "messages.h"
+
+namespace ny {
+
+bool is_question(std::uint8_t message_type)
+{
+  switch (message_type) {
+    case MSG_SELECT_BATTLECMD:
+    case MSG_SELECT_IDLECMD:
+    case MSG_SELECT_EFFECTYN:
+    case MSG_SELECT_YESNO:
+    case MSG_SELECT_OPTION:
+    case MSG_SELECT_CARD:
+    case MSG_SELECT_UNSELECT_CARD:
+    case MSG_SELECT_CHAIN:
+    case MSG_SELECT_PLACE:
+    case MSG_SELECT_DISFIELD:
+    case MSG_SELECT_POSITION:
+    case MSG_SELECT_TRIBUTE:
+    case MSG_SELECT_COUNTER:
+    case MSG_SELECT_SUM:
+    case MSG_SORT_CARD:
+    case MSG_ROCK_PAPER_SCISSORS:
+    case MSG_ANNOUNCE_RACE:
+    case MSG_ANNOUNCE_ATTRIB:
+    case MSG_ANNOUNCE_NUMBER:
+    case MSG_ANNOUNCE_CARD:
+      return true;
+    default:
+      return false;
+  }
+}
+
+namespace {
+
+/**
+ * walks a message body the way the parsers in @ego/message-protocol do,
+ * without decoding anything. any read past `end' poisons the cursor.
+ */
+struct Cursor
+{
+  unsigned char const *at;
+  unsigned char const *end;
+  bool                 ok = true;
+
+  void skip(std::size_t n)
+  {
+    if (!ok || std::size_t(end - at) < n) {
+      ok = false;
+      return;
+    }
+    at += n;
+  }
+
+  std::uint8_t u8()
+  {
+    if (!ok || at == end) {
+      ok = false;
+      return 0;
+    }
+    return *at++;
+  }
+
+  /** a u8 count followed by that many `size' byte items. */
+  void list(std::size_t size)
+  {
+    auto const n = u8();
+    skip(n * size);
+  }
+};
+
+/** code, controller, location, sequence */
+constexpr std::size_t card_size      = 7;
+/** controller, location, sequence, subsequence */
+constexpr std::size_t location_size  = 4;
+
+} // namespace
+
+std::size_t message_length(unsigned char const *data, std::size_t available)
+{
+  if (available == 0) {
+    return 0;
+  }
+
+  auto cursor = Cursor { data + 1, data + available };
+
+  switch (data[0]) {
+    case MSG_RETRY:
+    case MSG_WAITING:
+    case MSG_REVERSE_DECK:
+    case MSG_SUMMONED:
+    case MSG_SPSUMMONED:
+    case MSG_FLIPSUMMONED:
+    case MSG_CHAIN_END:
+    case MSG_CARD_SELECTED:
+    case MSG_ATTACK_DISABLED:
+    case MSG_DAMAGE_STEP_START:
+    case MSG_DAMAGE_STEP_END:
+      break;
+
+    case MSG_SHUFFLE_DECK:
+    case MSG_REFRESH_DECK:
+    case MSG_SWAP_GRAVE_DECK:
+    case MSG_NEW_TURN:
+    case MSG_CHAINED:
+    case MSG_CHAIN_SOLVING:
+    case MSG_CHAIN_SOLVED:
+    case MSG_CHAIN_NEGATED:
+    case MSG_CHAIN_DISABLED:
+    case MSG_ROCK_PAPER_SCISSORS:
+    case MSG_HAND_RES:
+      cursor.skip(1);
+      break;
+
+    case MSG_WIN:
+    case MSG_NEW_PHASE:
+      cursor.skip(2);
+      break;
+
+    case MSG_UNEQUIP:
+    case MSG_FIELD_DISABLED:
+    case MSG_MATCH_KILL:
+      cursor.skip(4);
+      break;
+
+    case MSG_SELECT_YESNO:
+    case MSG_DAMAGE:
+    case MSG_RECOVER:
+    case MSG_LPUPDATE:
+    case MSG_PAY_LPCOST:
+    case MSG_TAG_SWAP:
+      cursor.skip(5);
+      break;
+
+    case MSG_HINT:
+    case MSG_SELECT_PLACE:
+    case MSG_SELECT_DISFIELD:
+    case MSG_SELECT_POSITION:
+    case MSG_DECK_TOP:
+    case MSG_ANNOUNCE_RACE:
+    case MSG_ANNOUNCE_ATTRIB:
+    case MSG_PLAYER_HINT:
+      cursor.skip(6);
+      break;
+
+    case MSG_ADD_COUNTER:
+    case MSG_REMOVE_COUNTER:
+      cursor.skip(7);
+      break;
+
+    case MSG_SET:
+    case MSG_SUMMONING:
+    case MSG_SPSUMMONING:
+    case MSG_FLIPSUMMONING:
+    case MSG_EQUIP:
+    case MSG_CARD_TARGET:
+    case MSG_CANCEL_TARGET:
+    case MSG_ATTACK:
+    case MSG_MISSED_EFFECT:
+      cursor.skip(8);
+      break;
+
+    case MSG_POS_CHANGE:
+    case MSG_CARD_HINT:
+      cursor.skip(9);
+      break;
+
+    case MSG_SELECT_EFFECTYN:
+      cursor.skip(13);
+      break;
+
+    case MSG_MOVE:
+    case MSG_SWAP:
+    case MSG_CHAINING:
+      cursor.skip(16);
+      break;
+
+    case MSG_START:
+      cursor.skip(17);
+      break;
+
+    case MSG_BATTLE:
+      cursor.skip(26);
+      break;
+
+    case MSG_SELECT_BATTLECMD:
+      cursor.skip(1);
+      cursor.list(card_size + 4);
+      cursor.list(card_size + 1);
+      cursor.skip(2);
+      break;
+
+    case MSG_SELECT_IDLECMD:
+      cursor.skip(1);
+      for (int i = 0; i != 5; ++i) {
+        cursor.list(card_size);
+      }
+      cursor.list(card_size + 4);
+      cursor.skip(3);
+      break;
+
+    case MSG_SELECT_OPTION:
+    case MSG_SHUFFLE_HAND:
+    case MSG_SHUFFLE_EXTRA:
+    case MSG_DRAW:
+    case MSG_ANNOUNCE_NUMBER:
+    case MSG_ANNOUNCE_CARD:
+      cursor.skip(1);
+      cursor.list(4);
+      break;
+
+    case MSG_SELECT_CARD:
+    case MSG_SELECT_TRIBUTE:
+      cursor.skip(4);
+      cursor.list(card_size + 1);
+      break;
+
+    case MSG_SELECT_UNSELECT_CARD:
+      cursor.skip(5);
+      cursor.list(card_size + 1);
+      cursor.list(card_size + 1);
+      break;
+
+    case MSG_SELECT_CHAIN: {
+      cursor.skip(1);
+      auto const n = cursor.u8();
+      cursor.skip(10);
+      cursor.skip(n * 13);
+      break;
+    }
+
+    case MSG_SELECT_COUNTER:
+      cursor.skip(5);
+      cursor.list(card_size + 2);
+      break;
+
+    case MSG_SELECT_SUM:
+      cursor.skip(8);
+      cursor.list(card_size + 4);
+      cursor.list(card_size + 4);
+      break;
+
+    case MSG_SORT_CARD:
+    case MSG_CONFIRM_DECKTOP:
+    case MSG_CONFIRM_EXTRATOP:
+    case MSG_CONFIRM_CARDS:
+      cursor.skip(1);
+      cursor.list(card_size);
+      break;
+
+    case MSG_SHUFFLE_SET_CARD: {
+      cursor.skip(1);
+      auto const n = cursor.u8();
+      cursor.skip(n * location_size * 2);
+      break;
+    }
+
+    case MSG_BECOME_TARGET:
+      cursor.list(location_size);
+      break;
+
+    case MSG_RANDOM_SELECTED:
+      cursor.skip(1);
+      cursor.list(location_size);
+      break;
+
+    case MSG_TOSS_COIN:
+    case MSG_TOSS_DICE:
+      cursor.skip(1);
+      cursor.list(1);
+      break;
+
+    case MSG_RELOAD_FIELD:
+      cursor.skip(1);
+      for (int player = 0; player != 4; ++player) {
+        cursor.skip(4);
+        for (int i = 0; i != 7; ++i) {
+          if (cursor.u8()) cursor.skip(2);
+        }
+        for (int i = 0; i != 8; ++i) {
+          if (cursor.u8()) cursor.skip(1);
+        }
+        cursor.skip(6);
+        cursor.list(15);
+      }
+      break;
+
+    /* host framed query results, they run to the end of the buffer. */
+    case MSG_UPDATE_DATA:
+    case MSG_UPDATE_CARD:
+      cursor.at = cursor.end;
+      break;
+
+    default:
+      return 0;
+  }
+
+  return cursor.ok ? std::size_t(cursor.at - data) : 0;
+}
+
+std::uint8_t message_recipient(unsigned char const *data, std::size_t length)
+{
+  auto const at = [&](std::size_t offset) -> std::uint8_t {
+    return offset < length ? data[offset] : 0;
+  };
+
+  switch (data[0]) {
+    case MSG_SELECT_SUM:
+      return at(2);
+
+    case MSG_HINT:
+      switch (at(1)) {
+        case 1: case 2: case 3: case 5:
+          return at(2);
+        case 4: case 6: case 7: case 8: case 9: case 11:
+          return recipient_except | at(2);
+        default:
+          return recipient_all;
+      }
+
+    case MSG_CONFIRM_CARDS:
+      /* cards confirmed from the deck are only shown to their owner. */
+      return at(2) && at(8) == 0x01 ? at(1) : recipient_all;
+
+    case MSG_MISSED_EFFECT:
+      return at(1);
+
+    default:
+      return is_question(data[0]) ? at(1) : recipient_all;
+  }
+}
+
+void frame_messages( unsigned char const       *data
+                   , std::size_t                length
+                   , std::uint32_t              base
+                   , std::vector<MessageFrame> &frames)
+{
+  for (std::size_t offset = 0; offset < length; ) {
+    auto const message   = data + offset;
+    auto       framed    = message_length(message, length - offset);
+    auto       recipient = framed ? message_recipient(message, framed) : recipient_all;
+
+    if (framed == 0) {
+      framed = length - offset;
+    }
+
+    frames.push_back(MessageFrame { std::uint32_t(base + offset)
+                                  , std::uint32_t(framed)
+                                  , message[0]
+                                  , recipient
+                                  , 0 });
+    offset += framed;
+  }
+}
+
+std::size_t begin_step( std::vector<unsigned char> &pending
+                      , std::size_t                 capacity)
+{
+  auto const offset = pending.size();
+  pending.resize(offset + capacity);
+
+  return offset;
+}
+
+bool end_step( std::vector<unsigned char> &pending
+             , std::size_t                 offset
+             , std::size_t                 length
+             , std::vector<MessageFrame>  &frames
+             , MessageTypeSet const       &stop_after)
+{
+  pending.resize(offset + length);
+
+  auto const first_frame = frames.size();
+  frame_messages(pending.data() + offset, length, std::uint32_t(offset), frames);
+
+  for (auto i = first_frame; i != frames.size(); ++i) {
+    auto const &frame = frames[i];
+    if (frame.type == MSG_RETRY || frame.type == MSG_WIN || is_question(frame.type) || stop_after[frame.type]) {
+      return true;
+    }
+  }
+
+  if (first_frame != frames.size()) {
+    auto const &last = frames.back();
+    return message_length(pending.data() + last.offset, last.length) != last.length;
+  }
+
+  return false;
+}
+
+} // namespace ny
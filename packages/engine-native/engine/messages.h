@@ -0,0 +1,180 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ny {
+
+/**
+ * ocgcore message types, see `MSG' in @ego/message-protocol.
+ */
+enum MessageType : std::uint8_t
+{
+  MSG_RETRY                = 1,
+  MSG_HINT                 = 2,
+  MSG_WAITING              = 3,
+  MSG_START                = 4,
+  MSG_WIN                  = 5,
+  MSG_UPDATE_DATA          = 6,
+  MSG_UPDATE_CARD          = 7,
+  MSG_SELECT_BATTLECMD     = 10,
+  MSG_SELECT_IDLECMD       = 11,
+  MSG_SELECT_EFFECTYN      = 12,
+  MSG_SELECT_YESNO         = 13,
+  MSG_SELECT_OPTION        = 14,
+  MSG_SELECT_CARD          = 15,
+  MSG_SELECT_CHAIN         = 16,
+  MSG_SELECT_PLACE         = 18,
+  MSG_SELECT_POSITION      = 19,
+  MSG_SELECT_TRIBUTE       = 20,
+  MSG_SELECT_COUNTER       = 22,
+  MSG_SELECT_SUM           = 23,
+  MSG_SELECT_DISFIELD      = 24,
+  MSG_SORT_CARD            = 25,
+  MSG_SELECT_UNSELECT_CARD = 26,
+  MSG_CONFIRM_DECKTOP      = 30,
+  MSG_CONFIRM_CARDS        = 31,
+  MSG_SHUFFLE_DECK         = 32,
+  MSG_SHUFFLE_HAND         = 33,
+  MSG_REFRESH_DECK         = 34,
+  MSG_SWAP_GRAVE_DECK      = 35,
+  MSG_SHUFFLE_SET_CARD     = 36,
+  MSG_REVERSE_DECK         = 37,
+  MSG_DECK_TOP             = 38,
+  MSG_SHUFFLE_EXTRA        = 39,
+  MSG_NEW_TURN             = 40,
+  MSG_NEW_PHASE            = 41,
+  MSG_CONFIRM_EXTRATOP     = 42,
+  MSG_MOVE                 = 50,
+  MSG_POS_CHANGE           = 53,
+  MSG_SET                  = 54,
+  MSG_SWAP                 = 55,
+  MSG_FIELD_DISABLED       = 56,
+  MSG_SUMMONING            = 60,
+  MSG_SUMMONED             = 61,
+  MSG_SPSUMMONING          = 62,
+  MSG_SPSUMMONED           = 63,
+  MSG_FLIPSUMMONING        = 64,
+  MSG_FLIPSUMMONED         = 65,
+  MSG_CHAINING             = 70,
+  MSG_CHAINED              = 71,
+  MSG_CHAIN_SOLVING        = 72,
+  MSG_CHAIN_SOLVED         = 73,
+  MSG_CHAIN_END            = 74,
+  MSG_CHAIN_NEGATED        = 75,
+  MSG_CHAIN_DISABLED       = 76,
+  MSG_CARD_SELECTED        = 80,
+  MSG_RANDOM_SELECTED      = 81,
+  MSG_BECOME_TARGET        = 83,
+  MSG_DRAW                 = 90,
+  MSG_DAMAGE               = 91,
+  MSG_RECOVER              = 92,
+  MSG_EQUIP                = 93,
+  MSG_LPUPDATE             = 94,
+  MSG_UNEQUIP              = 95,
+  MSG_CARD_TARGET          = 96,
+  MSG_CANCEL_TARGET        = 97,
+  MSG_PAY_LPCOST           = 100,
+  MSG_ADD_COUNTER          = 101,
+  MSG_REMOVE_COUNTER       = 102,
+  MSG_ATTACK               = 110,
+  MSG_BATTLE               = 111,
+  MSG_ATTACK_DISABLED      = 112,
+  MSG_DAMAGE_STEP_START    = 113,
+  MSG_DAMAGE_STEP_END      = 114,
+  MSG_MISSED_EFFECT        = 120,
+  MSG_TOSS_COIN            = 130,
+  MSG_TOSS_DICE            = 131,
+  MSG_ROCK_PAPER_SCISSORS  = 132,
+  MSG_HAND_RES             = 133,
+  MSG_ANNOUNCE_RACE        = 140,
+  MSG_ANNOUNCE_ATTRIB      = 141,
+  MSG_ANNOUNCE_CARD        = 142,
+  MSG_ANNOUNCE_NUMBER      = 143,
+  MSG_CARD_HINT            = 160,
+  MSG_TAG_SWAP             = 161,
+  MSG_RELOAD_FIELD         = 162,
+  MSG_PLAYER_HINT          = 165,
+  MSG_MATCH_KILL           = 170,
+};
+
+/**
+ * a set of message types, indexed by type.
+ */
+using MessageTypeSet = std::bitset<256>;
+
+/**
+ * same set as `isQuestionMessage' in @ego/message-protocol.
+ */
+bool is_question(std::uint8_t message_type);
+
+/**
+ * length in bytes of the message at `data' (type byte included), reading at
+ * most `available' bytes.
+ *
+ * returns 0 if the message is truncated or of a type @ego/message-protocol
+ * cannot parse either, the rest of the buffer can not be framed then.
+ */
+std::size_t message_length(unsigned char const *data, std::size_t available);
+
+/**
+ * who a message is meant for, as ygopro's SingleDuel::Analyze routes them:
+ * a player (0 or 1), everyone but a player (`recipient_except | player'),
+ * or everyone (`recipient_all').
+ *
+ * visibility of the content is not considered, a MSG_DRAW goes to everyone.
+ */
+constexpr std::uint8_t recipient_except = 0x80;
+constexpr std::uint8_t recipient_all    = 0xFF;
+
+/**
+ * `data' must hold the whole message, see `message_length'.
+ */
+std::uint8_t message_recipient(unsigned char const *data, std::size_t length);
+
+/**
+ * one message in a buffer of messages, index entries handed to js as is.
+ */
+struct MessageFrame
+{
+  std::uint32_t offset;
+  std::uint32_t length;
+  std::uint8_t  type;
+  std::uint8_t  recipient;
+  std::uint16_t reserved;
+};
+
+static_assert(sizeof(MessageFrame) == 12, "MessageFrame layout changed");
+
+/**
+ * appends a frame for each message in `data', `base' is added to offsets.
+ * a tail that can not be framed ends up in one last frame (type taken from
+ * its first byte, sent to everyone), so frames always cover all of `data'.
+ */
+void frame_messages( unsigned char const       *data
+                   , std::size_t                length
+                   , std::uint32_t              base
+                   , std::vector<MessageFrame> &frames);
+
+/**
+ * one step of the message pump, as `CoreEngine::run_until_decision' takes
+ * it: `begin_step' grows `pending' by `capacity' bytes and returns where
+ * the step writes to, `end_step' trims `pending' to the `length' bytes it
+ * wrote there and frames them.
+ *
+ * `end_step' returns true if ocgcore wants to hear from a player (or is
+ * done) after those messages, or one of them is in `stop_after'. a tail
+ * that can not be framed stops the run as well, js gets to see it as it is.
+ */
+std::size_t begin_step( std::vector<unsigned char> &pending
+                      , std::size_t                 capacity);
+
+bool end_step( std::vector<unsigned char> &pending
+             , std::size_t                 offset
+             , std::size_t                 length
+             , std::vector<MessageFrame>  &frames
+             , MessageTypeSet const       &stop_after);
+
+} // namespace ny
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ny {
+
+// mind the order...
+struct Record
+{
+  std::uint32_t code;
+  std::uint32_t alias;
+  std::uint64_t setcode;
+  std::uint32_t type;
+  std::uint32_t level;
+  std::uint32_t attribute;
+  std::uint32_t race;
+  std::int32_t  attack;
+  std::int32_t  defense;
+  std::uint32_t lscale;
+  std::uint32_t rscale;
+  std::uint32_t link_marker;
+};
+
+/**
+ * `DataStore::addMany' takes records packed back to back in exactly this
+ * layout (little endian, 4 bytes of padding at the end of each).
+ */
+static_assert(sizeof(Record) == 56, "Record layout changed");
+
+} // namespace ny
@@ -0,0 +1,254 @@
+#include "replay.h"
+#include <cstring>
+#include <random>
+#include <lzma.h>
+
+namespace ny {
+
+bool unpack_responses( std::uint8_t const *packed
+                     , std::size_t         length
+                     , ReplayResponses    &responses)
+{
+  responses.data.clear();
+  responses.offsets.assign(1, 0);
+
+  for (std::size_t at = 0; at < length; ) {
+    auto const size = packed[at++];
+    if (size > 64 || length - at < size) {
+      return false;
+    }
+
+    responses.data.insert(responses.data.end(), packed + at, packed + at + size);
+    responses.offsets.push_back(responses.data.size());
+    at += size;
+  }
+
+  return true;
+}
+
+bool split_responses( std::uint8_t const  *data
+                    , std::size_t          length
+                    , std::uint32_t const *offsets
+                    , std::size_t          count
+                    , ReplayResponses     &responses)
+{
+  if (count == 0 || offsets[0] != 0 || offsets[count - 1] != length) {
+    return false;
+  }
+
+  for (std::size_t i = 1; i != count; ++i) {
+    if (offsets[i] < offsets[i - 1] || offsets[i] - offsets[i - 1] > 64) {
+      return false;
+    }
+  }
+
+  responses.data.assign(data, data + length);
+  responses.offsets.assign(offsets, offsets + count);
+
+  return true;
+}
+
+namespace {
+
+/**
+ * reads little endian integers off a replay body, any read past `end'
+ * poisons it.
+ */
+struct BodyReader
+{
+  std::uint8_t const *at;
+  std::uint8_t const *end;
+  bool                ok = true;
+
+  std::uint8_t const *take(std::size_t n)
+  {
+    if (!ok || std::size_t(end - at) < n) {
+      ok = false;
+      return nullptr;
+    }
+    auto const taken = at;
+    at += n;
+    return taken;
+  }
+
+  std::uint32_t u32()
+  {
+    auto const bytes = take(4);
+    return bytes
+      ? std::uint32_t(bytes[0]) | std::uint32_t(bytes[1]) << 8 | std::uint32_t(bytes[2]) << 16 | std::uint32_t(bytes[3]) << 24
+      : 0;
+  }
+};
+
+/**
+ * the body after the header, lzma `alone' format once the header's props
+ * and a 64 bit size are put in front (ygopro leaves them out).
+ */
+bool decompress( ReplayHeader const        &header
+               , std::uint8_t const        *data
+               , std::size_t                length
+               , std::vector<std::uint8_t> &body
+               , std::string               &error)
+{
+  if (header.data_size > replay_body_limit) {
+    error = "replay too large";
+    return false;
+  }
+
+  std::uint8_t alone_header[13];
+  std::memcpy(alone_header, header.props, 5);
+  for (int i = 0; i != 8; ++i) {
+    alone_header[5 + i] = i < 4 ? std::uint8_t(header.data_size >> (i * 8)) : 0;
+  }
+
+  lzma_stream stream = LZMA_STREAM_INIT;
+  if (lzma_alone_decoder(&stream, UINT64_MAX) != LZMA_OK) {
+    error = "lzma_alone_decoder failed";
+    return false;
+  }
+
+  body.resize(header.data_size);
+  stream.next_out  = body.data();
+  stream.avail_out = body.size();
+
+  stream.next_in  = alone_header;
+  stream.avail_in = sizeof alone_header;
+  auto result = lzma_code(&stream, LZMA_RUN);
+
+  if (result == LZMA_OK) {
+    stream.next_in  = data;
+    stream.avail_in = length;
+    result = lzma_code(&stream, LZMA_FINISH);
+  }
+
+  auto const produced = body.size() - stream.avail_out;
+  lzma_end(&stream);
+
+  /* ygopro writes no end marker, a stream that stops at `data_size' is done. */
+  if ((result != LZMA_OK && result != LZMA_STREAM_END) || produced != body.size()) {
+    error = "corrupted replay (lzma)";
+    return false;
+  }
+
+  return true;
+}
+
+std::string utf8_name(std::uint8_t const *utf16, std::size_t units)
+{
+  auto name = std::string();
+  for (std::size_t i = 0; i != units; ++i) {
+    std::uint32_t c = utf16[i * 2] | utf16[i * 2 + 1] << 8;
+    if (c == 0) {
+      break;
+    }
+
+    if (c >= 0xD800 && c < 0xDC00 && i + 1 != units) {
+      std::uint32_t const low = utf16[i * 2 + 2] | utf16[i * 2 + 3] << 8;
+      if (low >= 0xDC00 && low < 0xE000) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        ++i;
+      }
+    }
+
+    if (c < 0x80) {
+      name += char(c);
+    } else if (c < 0x800) {
+      name += char(0xC0 | c >> 6);
+      name += char(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      name += char(0xE0 | c >> 12);
+      name += char(0x80 | (c >> 6 & 0x3F));
+      name += char(0x80 | (c & 0x3F));
+    } else {
+      name += char(0xF0 | c >> 18);
+      name += char(0x80 | (c >> 12 & 0x3F));
+      name += char(0x80 | (c >> 6 & 0x3F));
+      name += char(0x80 | (c & 0x3F));
+    }
+  }
+
+  return name;
+}
+
+bool read_deck(BodyReader &reader, std::vector<std::uint32_t> &codes)
+{
+  auto const count = reader.u32();
+  if (!reader.ok || count > std::size_t(reader.end - reader.at) / 4) {
+    reader.ok = false;
+    return false;
+  }
+
+  codes.resize(count);
+  for (auto &code: codes) {
+    code = reader.u32();
+  }
+
+  return reader.ok;
+}
+
+} // namespace
+
+bool decode_replay( std::uint8_t const *data
+                  , std::size_t         length
+                  , ReplayFile         &replay
+                  , std::string        &error)
+{
+  auto &header = replay.header;
+  if (length < sizeof header) {
+    error = "truncated replay";
+    return false;
+  }
+  std::memcpy(&header, data, sizeof header);
+
+  if (header.flag & replay_single_mode) {
+    error = "single mode replays are not supported";
+    return false;
+  }
+
+  auto const rest        = data + sizeof header;
+  auto const rest_length = length - sizeof header;
+  auto       body        = std::vector<std::uint8_t>();
+
+  if (header.flag & replay_compressed) {
+    if (!decompress(header, rest, rest_length, body, error)) {
+      return false;
+    }
+  } else {
+    body.assign(rest, rest + rest_length);
+  }
+
+  replay.duel_seed    = std::mt19937(header.seed)();
+  replay.player_count = header.flag & replay_tag ? 4 : 2;
+
+  auto reader = BodyReader { body.data(), body.data() + body.size() };
+
+  for (std::uint32_t i = 0; i != replay.player_count; ++i) {
+    if (auto const name = reader.take(40)) {
+      replay.names[i] = utf8_name(name, 20);
+    }
+  }
+
+  replay.lp      = reader.u32();
+  replay.start   = reader.u32();
+  replay.draw    = reader.u32();
+  replay.options = reader.u32();
+
+  for (std::uint32_t i = 0; i != replay.player_count; ++i) {
+    read_deck(reader, replay.decks[i].main);
+    read_deck(reader, replay.decks[i].extra);
+  }
+
+  if (!reader.ok) {
+    error = "truncated replay";
+    return false;
+  }
+
+  if (!unpack_responses(reader.at, reader.end - reader.at, replay.responses)) {
+    error = "corrupted replay (responses)";
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace ny
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ny {
+
+/**
+ * responses as a replay stores them, each a u8 length followed by that
+ * many bytes, split by an offset table: response `i' is
+ * `data[offsets[i], offsets[i + 1])'.
+ */
+struct ReplayResponses
+{
+  std::vector<std::uint8_t>  data;
+  std::vector<std::uint32_t> offsets;
+
+  std::size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+/**
+ * splits `length' bytes of packed responses, false if the last one is cut
+ * short or one is longer than ocgcore takes (64 bytes).
+ */
+bool unpack_responses( std::uint8_t const *packed
+                     , std::size_t         length
+                     , ReplayResponses    &responses);
+
+/**
+ * takes responses already split, `count' offsets into `data' (the first
+ * being 0, the last `length'). false if they do not add up, or one is
+ * longer than 64 bytes.
+ */
+bool split_responses( std::uint8_t const  *data
+                    , std::size_t          length
+                    , std::uint32_t const *offsets
+                    , std::size_t          count
+                    , ReplayResponses     &responses);
+
+struct ReplayDeck
+{
+  std::vector<std::uint32_t> main;
+  std::vector<std::uint32_t> extra;
+};
+
+/**
+ * everything a two player duel is created from, as `DuelDriver' does it.
+ * `seed' is the one handed to ocgcore (`ReplayReader.seed()').
+ */
+struct ReplaySetup
+{
+  std::uint32_t seed    = 0;
+  std::int32_t  lp      = 8000;
+  std::int32_t  start   = 5;
+  std::int32_t  draw    = 1;
+  std::int32_t  options = 0;
+  ReplayDeck    decks[2];
+};
+
+enum ReplayOutcome : std::uint32_t
+{
+  replay_finished  = 0, // MSG_WIN
+  replay_exhausted = 1, // asked for a response after the last one (a surrender)
+  replay_retry     = 2, // MSG_RETRY after response `retry_at'
+  replay_stalled   = 3, // no decision within `replay_step_limit' steps
+  replay_malformed = 4, // ocgcore emitted something that can not be framed
+  replay_ended     = 5, // ocgcore ended the duel without a MSG_WIN
+};
+
+constexpr std::uint32_t replay_step_limit = 1u << 20;
+constexpr std::uint32_t replay_no_retry   = 0xFFFFFFFFu;
+
+/**
+ * how a replay went, handed to js as is.
+ */
+struct ReplayVerdict
+{
+  std::uint32_t outcome   = replay_finished;
+  std::uint32_t consumed  = 0;  // responses set
+  std::uint32_t total     = 0;  // responses in the replay
+  std::uint32_t retry_at  = replay_no_retry;
+  std::uint32_t steps     = 0;  // process calls
+  std::uint8_t  winner    = 0xFF;
+  std::uint8_t  reason    = 0;
+  std::uint16_t reserved  = 0;
+};
+
+static_assert(sizeof(ReplayVerdict) == 24, "ReplayVerdict layout changed");
+
+struct ReplayJob
+{
+  ReplaySetup     setup;
+  ReplayResponses responses;
+  ReplayVerdict   verdict;
+};
+
+/**
+ * a ygopro replay file (.yrp):
+ *
+ *   ReplayHeader
+ *   body, lzma compressed if `replay_compressed' is set (`props' being the
+ *   lzma properties, `data_size' the body's size once decompressed)
+ *
+ * the body being player names (20 utf-16 code units each), lp, start
+ * hand, draw count, duel options, a main and an extra deck per player,
+ * then the packed responses to the end. integers little endian.
+ */
+struct ReplayHeader
+{
+  std::uint32_t id;
+  std::uint32_t version;
+  std::uint32_t flag;
+  std::uint32_t seed;
+  std::uint32_t data_size;
+  std::uint32_t hash;
+  std::uint8_t  props[8];
+};
+
+static_assert(sizeof(ReplayHeader) == 32, "ReplayHeader layout changed");
+
+constexpr std::uint32_t replay_compressed  = 0x1;
+constexpr std::uint32_t replay_tag         = 0x2;
+constexpr std::uint32_t replay_decoded     = 0x4;
+constexpr std::uint32_t replay_single_mode = 0x8;
+
+/**
+ * decompressed bodies larger than this are taken as corrupted.
+ */
+constexpr std::uint32_t replay_body_limit = 0x4000000;
+
+struct ReplayFile
+{
+  ReplayHeader    header;
+
+  /**
+   * what ocgcore is seeded with: the first output of a mt19937 seeded with
+   * `header.seed', as `ReplayReader.seed()' does it.
+   */
+  std::uint32_t   duel_seed    = 0;
+  std::uint32_t   player_count = 2;
+  std::string     names[4];     // utf-8
+  std::int32_t    lp           = 0;
+  std::int32_t    start        = 0;
+  std::int32_t    draw         = 0;
+  std::int32_t    options      = 0;
+  ReplayDeck      decks[4];
+  ReplayResponses responses;
+};
+
+/**
+ * false (with `error' set) if `data' is not a replay this can play: cut
+ * short, corrupted, or a single mode (puzzle) replay.
+ */
+bool decode_replay( std::uint8_t const *data
+                  , std::size_t         length
+                  , ReplayFile         &replay
+                  , std::string        &error);
+
+} // namespace ny
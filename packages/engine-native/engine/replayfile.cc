@@ -0,0 +1,104 @@
+#include "replayfile.h"
+#include "replay.h"
+#include "misc.h"
+#include <cstring>
+
+namespace ny {
+
+static
+void finalizer(void *, void *buffer)
+{
+  delete []static_cast<std::uint8_t *>(buffer);
+}
+
+template <typename T>
+static
+Napi::ArrayBuffer wrap_vector(Napi::Env env, std::vector<T> const &items)
+{
+  auto const size = items.size() * sizeof(T);
+  auto       copy = new std::uint8_t[size];
+  if (size) {
+    std::memcpy(copy, items.data(), size);
+  }
+
+  return Napi::ArrayBuffer::New(env, copy, size, finalizer);
+}
+
+static
+Napi::Array wrap_codes(Napi::Env env, std::vector<std::uint32_t> const &codes)
+{
+  auto array = Napi::Array::New(env, codes.size());
+  for (std::uint32_t i = 0; i != codes.size(); ++i) {
+    array.Set(i, Napi::Value::From(env, codes[i]));
+  }
+
+  return array;
+}
+
+/**
+ * returns `{ id, version, flag, time, hash, seed, lp, start, draw, options,
+ * players, responses, offsets }': `time' is the seed as stored (when the
+ * duel took place), `seed' the one ocgcore takes, `players' a `{ name,
+ * main, extra }' each. `responses' are back to back, response `i' being
+ * bytes `[offsets[i], offsets[i + 1])' (`offsets' holds u32s), which
+ * `verifyReplays' takes as is.
+ */
+Napi::Value readReplay(Napi::CallbackInfo const &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+
+  std::uint8_t const *data   = nullptr;
+  std::size_t         length = 0;
+
+  if (info[0].IsTypedArray()) {
+    auto view = info[0].As<Napi::TypedArray>();
+    data   = static_cast<std::uint8_t const *>(view.ArrayBuffer().Data()) + view.ByteOffset();
+    length = view.ByteLength();
+  } else if (info[0].IsArrayBuffer()) {
+    auto buffer = info[0].As<Napi::ArrayBuffer>();
+    data   = static_cast<std::uint8_t const *>(buffer.Data());
+    length = buffer.ByteLength();
+  } else {
+    Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto replay = ReplayFile();
+  auto error  = std::string();
+  if (!decode_replay(data, length, replay, error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto players = Napi::Array::New(env, replay.player_count);
+  for (std::uint32_t i = 0; i != replay.player_count; ++i) {
+    auto player = Napi::Object::New(env);
+    player.Set("name",  Napi::String::New(env, replay.names[i]));
+    player.Set("main",  wrap_codes(env, replay.decks[i].main));
+    player.Set("extra", wrap_codes(env, replay.decks[i].extra));
+    players.Set(i, player);
+  }
+
+  auto const &header = replay.header;
+  auto        result = Napi::Object::New(env);
+  result.Set("id",        Napi::Value::From(env, header.id));
+  result.Set("version",   Napi::Value::From(env, header.version));
+  result.Set("flag",      Napi::Value::From(env, header.flag));
+  result.Set("time",      Napi::Value::From(env, header.seed));
+  result.Set("hash",      Napi::Value::From(env, header.hash));
+  result.Set("seed",      Napi::Value::From(env, replay.duel_seed));
+  result.Set("lp",        Napi::Value::From(env, replay.lp));
+  result.Set("start",     Napi::Value::From(env, replay.start));
+  result.Set("draw",      Napi::Value::From(env, replay.draw));
+  result.Set("options",   Napi::Value::From(env, replay.options));
+  result.Set("players",   players);
+  result.Set("responses", wrap_vector(env, replay.responses.data));
+  result.Set("offsets",   wrap_vector(env, replay.responses.offsets));
+
+  return result;
+}
+
+} // namespace ny
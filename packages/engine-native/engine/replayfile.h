@@ -0,0 +1,12 @@
+#pragma once
+
+#include <napi.h>
+
+namespace ny {
+
+/**
+ * `readReplay(content)': decodes a .yrp file, see `decode_replay'.
+ */
+Napi::Value readReplay(Napi::CallbackInfo const &info);
+
+} // namespace ny
@@ -0,0 +1,129 @@
+#include "scriptarchive.h"
+#include "checksum.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ny {
+
+bool write_script_archive( std::string const              &path
+                         , std::vector<ScriptEntry> const &scripts
+                         , std::string                    &error)
+{
+  auto sorted = scripts;
+  std::sort( sorted.begin()
+           , sorted.end()
+           , [](ScriptEntry const &lhs, ScriptEntry const &rhs)
+             { return lhs.name != rhs.name ? lhs.name < rhs.name : lhs.flags < rhs.flags; });
+
+  auto size = sizeof(ScriptArchiveHeader) + sorted.size() * sizeof(ScriptArchiveEntry);
+  for (auto const &script: sorted) {
+    size += script.name.size() + script.body.size();
+  }
+
+  if (size > 0xFFFFFFFFu) {
+    error = "script archive too large";
+    return false;
+  }
+
+  std::vector<std::uint8_t> image(size);
+
+  auto offset = sizeof(ScriptArchiveHeader) + sorted.size() * sizeof(ScriptArchiveEntry);
+  std::vector<ScriptArchiveEntry> entries(sorted.size());
+
+  for (std::size_t i = 0; i != sorted.size(); ++i) {
+    auto const &name = sorted[i].name;
+    entries[i].name_offset = static_cast<std::uint32_t>(offset);
+    entries[i].name_length = static_cast<std::uint32_t>(name.size());
+    std::memcpy(image.data() + offset, name.data(), name.size());
+    offset += name.size();
+  }
+
+  for (std::size_t i = 0; i != sorted.size(); ++i) {
+    auto const &body = sorted[i].body;
+    entries[i].body_offset = static_cast<std::uint32_t>(offset);
+    entries[i].body_length = static_cast<std::uint32_t>(body.size());
+    entries[i].flags       = sorted[i].flags;
+    entries[i].reserved    = 0;
+    std::memcpy(image.data() + offset, body.data(), body.size());
+    offset += body.size();
+  }
+
+  if (!entries.empty()) {
+    std::memcpy( image.data() + sizeof(ScriptArchiveHeader)
+               , entries.data()
+               , entries.size() * sizeof(ScriptArchiveEntry));
+  }
+
+  ScriptArchiveHeader header;
+  std::memcpy(header.magic, script_archive_magic, sizeof header.magic);
+  header.version     = script_archive_version;
+  header.entry_count = static_cast<std::uint32_t>(entries.size());
+  header.checksum    = checksum(image.data() + sizeof header, image.size() - sizeof header);
+  std::memcpy(image.data(), &header, sizeof header);
+
+  return write_file_atomic(path, image.data(), image.size(), error);
+}
+
+bool open_script_archive( std::string const           &path
+                        , std::shared_ptr<MappedFile> &file
+                        , std::vector<ScriptEntry>    &scripts
+                        , std::string                 &error)
+{
+  auto mapped = MappedFile::open(path, error);
+  if (!mapped) {
+    return false;
+  }
+
+  ScriptArchiveHeader header;
+  if (mapped->size() < sizeof header) {
+    error = path + ": truncated script archive";
+    return false;
+  }
+  std::memcpy(&header, mapped->data(), sizeof header);
+
+  if (std::memcmp(header.magic, script_archive_magic, sizeof header.magic)) {
+    error = path + ": not a script archive";
+    return false;
+  }
+
+  if (header.version != script_archive_version) {
+    error = path + ": unsupported script archive version";
+    return false;
+  }
+
+  auto const size = mapped->size();
+  if ((size - sizeof header) / sizeof(ScriptArchiveEntry) < header.entry_count) {
+    error = path + ": truncated script archive";
+    return false;
+  }
+
+  if (checksum(mapped->data() + sizeof header, size - sizeof header) != header.checksum) {
+    error = path + ": corrupted script archive (checksum mismatch)";
+    return false;
+  }
+
+  auto const base = reinterpret_cast<char const *>(mapped->data());
+
+  scripts.clear();
+  scripts.reserve(header.entry_count);
+  for (std::uint32_t i = 0; i != header.entry_count; ++i) {
+    ScriptArchiveEntry entry;
+    std::memcpy(&entry, base + sizeof header + i * sizeof entry, sizeof entry);
+
+    if ( std::uint64_t(entry.name_offset) + entry.name_length > size
+      || std::uint64_t(entry.body_offset) + entry.body_length > size) {
+      error = path + ": corrupted script archive (entry out of range)";
+      return false;
+    }
+
+    scripts.push_back(ScriptEntry { std::string_view(base + entry.name_offset, entry.name_length)
+                                  , std::string_view(base + entry.body_offset, entry.body_length)
+                                  , entry.flags });
+  }
+
+  file = std::move(mapped);
+
+  return true;
+}
+
+} // namespace ny
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "mappedfile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ny {
+
+/**
+ * script archive, all scripts in one file:
+ *
+ *   ScriptArchiveHeader
+ *   ScriptArchiveEntry[entry_count]  sorted by name
+ *   names, then bodies, back to back
+ *
+ * a name may appear twice, once as lua source and once as precompiled
+ * bytecode (`script_entry_bytecode').
+ *
+ * offsets are from the start of the file, integers in host byte order,
+ * `checksum' covers everything after the header.
+ */
+struct ScriptArchiveHeader
+{
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t entry_count;
+  std::uint64_t checksum;
+};
+
+struct ScriptArchiveEntry
+{
+  std::uint32_t name_offset;
+  std::uint32_t name_length;
+  std::uint32_t body_offset;
+  std::uint32_t body_length;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+};
+
+constexpr std::uint32_t script_entry_bytecode = 0x1;
+
+static_assert(sizeof(ScriptArchiveHeader) == 24, "ScriptArchiveHeader layout changed");
+static_assert(sizeof(ScriptArchiveEntry)  == 24, "ScriptArchiveEntry layout changed");
+
+constexpr char          script_archive_magic[8] = { 'E', 'G', 'O', 'S', 'C', 'R', 'P', 'T' };
+constexpr std::uint32_t script_archive_version  = 2;
+
+struct ScriptEntry
+{
+  std::string_view name;
+  std::string_view body;
+  std::uint32_t    flags;
+};
+
+bool write_script_archive( std::string const              &path
+                         , std::vector<ScriptEntry> const &scripts
+                         , std::string                    &error);
+
+/**
+ * map `path'; `scripts' then points into `file'.
+ */
+bool open_script_archive( std::string const           &path
+                        , std::shared_ptr<MappedFile> &file
+                        , std::vector<ScriptEntry>    &scripts
+                        , std::string                 &error);
+
+} // namespace ny
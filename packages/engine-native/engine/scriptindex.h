@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+
+namespace ny {
+
+/**
+ * lua source and/or precompiled bytecode of one script, either may be
+ * missing (a default constructed view).
+ */
+struct Script
+{
+  std::string_view source;
+  std::string_view bytecode;
+
+  /**
+   * what ocgcore gets, `luaL_loadbuffer' takes both.
+   */
+  std::string_view preferred() const
+  {
+    return bytecode.data() ? bytecode : source;
+  }
+};
+
+/**
+ * scripts are keyed by basename, however ocgcore spells the path
+ * (`./script/c1234.lua', `script/c1234.lua', ...) resolves with one probe.
+ *
+ * only views are kept, whoever fills the index keeps names and bodies
+ * alive (see `ScriptStore').
+ */
+class ScriptIndex
+{
+  std::unordered_map<std::string_view, Script> by_filename;
+
+public:
+  /**
+   * nullptr if not found. `filename' may carry any directory prefix.
+   */
+  Script const *find(std::string_view filename) const
+  {
+    auto found = by_filename.find(basename(filename));
+    return found == by_filename.end() ? nullptr : &found->second;
+  }
+
+  /**
+   * the script for `filename', added if missing. the basename of
+   * `filename' becomes the key, it has to outlive the index.
+   */
+  Script &slot(std::string_view filename)
+  {
+    return by_filename[basename(filename)];
+  }
+
+  void reserve(std::size_t n) { by_filename.reserve(n); }
+
+  std::size_t size() const { return by_filename.size(); }
+
+  auto begin() const { return by_filename.begin(); }
+  auto end()   const { return by_filename.end(); }
+
+  static std::string_view basename(std::string_view filename)
+  {
+    auto slash = filename.find_last_of("/\\");
+    return slash == std::string_view::npos ? filename : filename.substr(slash + 1);
+  }
+};
+
+} // namespace ny
@@ -1,8 +1,26 @@
 #include "scriptstore.h"
+#include "scriptarchive.h"
 #include "misc.h"
 
 namespace ny {
 
+ScriptStore::ScriptStore(Napi::CallbackInfo const &info)
+  : Napi::ObjectWrap<ScriptStore>(info)
+{ }
+
+ScriptStore::~ScriptStore() = default;
+
+/**
+ * storage for an `add'ed script, and its slot in `index'.
+ */
+std::pair<OwnedScript *, Script *> ScriptStore::own(std::string_view filename)
+{
+  auto key    = std::string(ScriptIndex::basename(filename));
+  auto &entry = *owned.try_emplace(std::move(key)).first;
+
+  return { &entry.second, &index.slot(entry.first) };
+}
+
 Napi::Value ScriptStore::add(const Napi::CallbackInfo &info)
 {
   auto env   = info.Env();
@@ -12,17 +30,143 @@ Napi::Value ScriptStore::add(const Napi::CallbackInfo &info)
   GET_ARG_OF_TYPE(info, 0, String);
   GET_ARG_OF_TYPE(info, 1, String);
 
-  auto filename = arg0.Utf8Value();
-  auto content  = arg1.Utf8Value();
+  if (frozen) {
+    Napi::Error::New(env, "Error: ScriptStore is frozen").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto [script, slot] = own(arg0.Utf8Value());
+
+  // new source, stale bytecode (if any) goes.
+  script->source = arg1.Utf8Value();
+  script->bytecode.clear();
+  slot->source   = script->source;
+  slot->bytecode = std::string_view();
+
+  return Napi::Value();
+}
+
+/**
+ * precompiled lua bytecode (`luac' output, matching the lua ocgcore is
+ * built with) for a script, served in place of its source.
+ */
+Napi::Value ScriptStore::addCompiled(const Napi::CallbackInfo &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 2);
+  GET_ARG_OF_TYPE(info, 0, String);
+
+  if (frozen) {
+    Napi::Error::New(env, "Error: ScriptStore is frozen").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  char const  *data   = nullptr;
+  std::size_t  length = 0;
+
+  if (info[1].IsTypedArray()) {
+    auto view = info[1].As<Napi::TypedArray>();
+    data   = static_cast<char const *>(view.ArrayBuffer().Data()) + view.ByteOffset();
+    length = view.ByteLength();
+  } else if (info[1].IsArrayBuffer()) {
+    auto buffer = info[1].As<Napi::ArrayBuffer>();
+    data   = static_cast<char const *>(buffer.Data());
+    length = buffer.ByteLength();
+  } else {
+    Napi::TypeError::New(env, "Error: ArrayBuffer expected").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto [script, slot] = own(arg0.Utf8Value());
+
+  script->bytecode.assign(data, length);
+  slot->bytecode = script->bytecode;
+
+  return Napi::Value();
+}
+
+/**
+ * write every script in the store to one archive.
+ */
+Napi::Value ScriptStore::saveArchive(const Napi::CallbackInfo &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, String);
 
-  by_filename[filename] = content;
+  std::vector<ScriptEntry> scripts;
+  for (auto const &script: index) {
+    if (script.second.source.data()) {
+      scripts.push_back(ScriptEntry { script.first, script.second.source, 0 });
+    }
+    if (script.second.bytecode.data()) {
+      scripts.push_back(ScriptEntry { script.first, script.second.bytecode, script_entry_bytecode });
+    }
+  }
+
+  auto error = std::string();
+  if (!write_script_archive(arg0.Utf8Value(), scripts, error)) {
+    Napi::Error::New(env, "Error: saveArchive: " + error).ThrowAsJavaScriptException();
+  }
 
   return Napi::Value();
 }
 
-std::map<std::string, std::string> const &ScriptStore::scripts() const
+/**
+ * map an archive, its scripts are served straight from the mapping.
+ * replaces scripts of the same name, returns the number of scripts in it.
+ */
+Napi::Value ScriptStore::loadArchive(const Napi::CallbackInfo &info)
 {
-  return by_filename;
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  REQUIRE_N_ARGS(info, 1);
+  GET_ARG_OF_TYPE(info, 0, String);
+
+  if (frozen) {
+    Napi::Error::New(env, "Error: ScriptStore is frozen").ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  auto file    = std::shared_ptr<MappedFile>();
+  auto scripts = std::vector<ScriptEntry>();
+  auto error   = std::string();
+  if (!open_script_archive(arg0.Utf8Value(), file, scripts, error)) {
+    Napi::Error::New(env, "Error: loadArchive: " + error).ThrowAsJavaScriptException();
+    return Napi::Value();
+  }
+
+  index.reserve(index.size() + scripts.size());
+  for (auto const &script: scripts) {
+    auto &slot = index.slot(script.name);
+    if (script.flags & script_entry_bytecode) {
+      slot.bytecode = script.body;
+    } else {
+      slot.source   = script.body;
+    }
+  }
+  archives.push_back(std::move(file));
+
+  return Napi::Value::From(env, static_cast<std::uint32_t>(scripts.size()));
+}
+
+/**
+ * no more scripts from now on, the store can then be read from other
+ * threads (`processAsync', `stepMany' and friends require it).
+ */
+Napi::Value ScriptStore::freeze(const Napi::CallbackInfo &info)
+{
+  auto env   = info.Env();
+  auto scope = Napi::HandleScope(env);
+
+  frozen = true;
+
+  return Napi::Value();
 }
 
 Napi::FunctionReference ScriptStore::constructor;
@@ -31,7 +175,12 @@ Napi::Function ScriptStore::initialize(Napi::Env &env)
 {
   auto klass = ScriptStore::DefineClass( env
                                        , "ScriptStore"
-                                       , { ScriptStore::InstanceMethod("add", &ScriptStore::add) });
+                                       , { ScriptStore::InstanceMethod("add", &ScriptStore::add)
+                                         , ScriptStore::InstanceMethod("addCompiled", &ScriptStore::addCompiled)
+                                         , ScriptStore::InstanceMethod("saveArchive", &ScriptStore::saveArchive)
+                                         , ScriptStore::InstanceMethod("loadArchive", &ScriptStore::loadArchive)
+                                         , ScriptStore::InstanceMethod("freeze", &ScriptStore::freeze)
+                                         });
   ScriptStore::constructor = Napi::Persistent(klass);
   ScriptStore::constructor.SuppressDestruct();
 
@@ -39,4 +188,3 @@ Napi::Function ScriptStore::initialize(Napi::Env &env)
 }
 
 } // namespace ny
-
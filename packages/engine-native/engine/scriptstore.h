@@ -1,26 +1,69 @@
 #pragma once
 
+#include "scriptindex.h"
 #include <cstdint>
 #include <napi.h>
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace ny {
 
+class MappedFile;
+
+struct OwnedScript
+{
+  std::string source;
+  std::string bytecode;
+};
+
+/**
+ * scripts from js or archives, served through a `ScriptIndex'.
+ */
 class ScriptStore : public Napi::ObjectWrap<ScriptStore>
 {
-  std::map<std::string, std::string> by_filename;
+  /**
+   * scripts `add'ed from js.
+   */
+  std::map<std::string, OwnedScript>                        owned;
+
+  /**
+   * mapped script archives (see scriptarchive.h).
+   */
+  std::vector<std::shared_ptr<MappedFile>>                  archives;
+
+  /**
+   * views into `owned' or `archives'.
+   */
+  ScriptIndex                                               index;
+
+  /**
+   * see `freeze'.
+   */
+  bool                                                      frozen = false;
 
 public:
-  std::map<std::string, std::string> const &scripts() const;
+  ScriptStore(Napi::CallbackInfo const &info);
+  ~ScriptStore();
+
+  ScriptIndex const &scripts() const { return index; }
+
+  bool is_frozen() const { return frozen; }
+
+private:
+  std::pair<OwnedScript *, Script *> own(std::string_view filename);
 
 public:
   Napi::Value add(Napi::CallbackInfo const &info);
+  Napi::Value addCompiled(Napi::CallbackInfo const &info);
+  Napi::Value saveArchive(Napi::CallbackInfo const &info);
+  Napi::Value loadArchive(Napi::CallbackInfo const &info);
+  Napi::Value freeze(Napi::CallbackInfo const &info);
 
 public:
   static Napi::Function initialize(Napi::Env &);
   static Napi::FunctionReference constructor;
-
-  using Napi::ObjectWrap<ScriptStore>::ObjectWrap;
 };
 
 } // namespace ny
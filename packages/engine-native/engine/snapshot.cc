@@ -0,0 +1,111 @@
+#include "snapshot.h"
+#include "checksum.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <vector>
+
+namespace ny {
+
+bool write_snapshot(std::string const &path, CardIndex const &index, std::string &error)
+{
+  if (!index.is_frozen()) {
+    error = "card index is not frozen";
+    return false;
+  }
+
+  auto const records_size = index.size()       * sizeof(Record);
+  auto const slots_size   = index.slot_count() * sizeof(CardIndex::Slot);
+
+  std::vector<std::uint8_t> image(sizeof(SnapshotHeader) + records_size + slots_size);
+
+  auto body = image.data() + sizeof(SnapshotHeader);
+  if (records_size) std::memcpy(body,                index.record_data(), records_size);
+  if (slots_size)   std::memcpy(body + records_size, index.slot_data(),   slots_size);
+
+  SnapshotHeader header;
+  std::memcpy(header.magic, snapshot_magic, sizeof header.magic);
+  header.version      = snapshot_version;
+  header.record_size  = sizeof(Record);
+  header.record_count = static_cast<std::uint32_t>(index.size());
+  header.slot_count   = static_cast<std::uint32_t>(index.slot_count());
+  header.checksum     = checksum(body, records_size + slots_size);
+  std::memcpy(image.data(), &header, sizeof header);
+
+  return write_file_atomic(path, image.data(), image.size(), error);
+}
+
+bool open_snapshot(std::string const &path, CardIndex &index, std::string &error)
+{
+  auto file = MappedFile::open(path, error);
+  if (!file) {
+    return false;
+  }
+
+  SnapshotHeader header;
+  if (file->size() < sizeof header) {
+    error = path + ": truncated snapshot";
+    return false;
+  }
+  std::memcpy(&header, file->data(), sizeof header);
+
+  if (std::memcmp(header.magic, snapshot_magic, sizeof header.magic)) {
+    error = path + ": not a card snapshot";
+    return false;
+  }
+
+  if (header.version != snapshot_version || header.record_size != sizeof(Record)) {
+    error = path + ": unsupported snapshot version";
+    return false;
+  }
+
+  /* as `CardIndex::freeze' lays it out: at least `min_slots', at least
+     half of them empty, so a probe always ends. */
+  if (header.slot_count < CardIndex::min_slots
+      || (header.slot_count & (header.slot_count - 1))
+      || header.slot_count / 2 < header.record_count) {
+    error = path + ": corrupted snapshot (slot count)";
+    return false;
+  }
+
+  auto const records_size = std::size_t(header.record_count) * sizeof(Record);
+  auto const slots_size   = std::size_t(header.slot_count)   * sizeof(CardIndex::Slot);
+  if (file->size() != sizeof header + records_size + slots_size) {
+    error = path + ": truncated snapshot";
+    return false;
+  }
+
+  auto body = file->data() + sizeof header;
+  if (checksum(body, records_size + slots_size) != header.checksum) {
+    error = path + ": corrupted snapshot (checksum mismatch)";
+    return false;
+  }
+
+  auto records = reinterpret_cast<Record const *>(body);
+  auto slots   = reinterpret_cast<CardIndex::Slot const *>(body + records_size);
+
+  /* the checksum only catches accidents, a crafted or mis-built file must
+     not send `find' past the records. */
+  std::size_t used = 0;
+  for (std::size_t i = 0; i != header.slot_count; ++i) {
+    auto const &slot = slots[i];
+    if (slot.index == CardIndex::empty_slot) {
+      continue;
+    }
+    if (slot.index >= header.record_count || records[slot.index].code != slot.code) {
+      error = path + ": corrupted snapshot (slot " + std::to_string(i) + ")";
+      return false;
+    }
+    ++used;
+  }
+
+  if (used != header.record_count) {
+    error = path + ": corrupted snapshot (slot count)";
+    return false;
+  }
+
+  index.adopt(records, header.record_count, slots, header.slot_count, std::move(file));
+
+  return true;
+}
+
+} // namespace ny
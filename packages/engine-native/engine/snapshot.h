@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cardindex.h"
+#include <string>
+
+namespace ny {
+
+/**
+ * card table snapshot, a frozen `CardIndex' as it sits in memory:
+ *
+ *   SnapshotHeader
+ *   Record[record_count]        sorted by code
+ *   CardIndex::Slot[slot_count] the probe table, slot_count a power of two
+ *
+ * all integers in host byte order, `checksum' covers everything after the
+ * header. mapping it read-only lets every worker share one copy.
+ */
+struct SnapshotHeader
+{
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t record_size;
+  std::uint32_t record_count;
+  std::uint32_t slot_count;
+  std::uint64_t checksum;
+};
+
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout changed");
+
+constexpr char          snapshot_magic[8] = { 'E', 'G', 'O', 'C', 'A', 'R', 'D', 'S' };
+constexpr std::uint32_t snapshot_version  = 1;
+
+/**
+ * `index' must be frozen.
+ */
+bool write_snapshot(std::string const &path, CardIndex const &index, std::string &error);
+
+/**
+ * map `path' and let `index' adopt it.
+ */
+bool open_snapshot(std::string const &path, CardIndex &index, std::string &error);
+
+} // namespace ny
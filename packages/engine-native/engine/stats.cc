@@ -0,0 +1,133 @@
+#include "stats.h"
+#include <algorithm>
+
+namespace ny {
+
+char const *counter_name(StatsCounter counter)
+{
+  switch (counter) {
+    case stat_process_calls: return "processCalls";
+    case stat_message_bytes: return "messageBytes";
+    case stat_card_hits:     return "cardHits";
+    case stat_card_misses:   return "cardMisses";
+    case stat_script_hits:   return "scriptHits";
+    case stat_script_misses: return "scriptMisses";
+    case stat_query_calls:   return "queryCalls";
+    default:                 return "unknown";
+  }
+}
+
+char const *timer_name(StatsTimer timer)
+{
+  switch (timer) {
+    case timer_process:          return "process";
+    case timer_query_field_card: return "queryFieldCard";
+    case timer_set_response:     return "setResponse";
+    default:                     return "unknown";
+  }
+}
+
+/**
+ * below `2 ^ (sub_bits + 1)' a bucket per value, then for each power of
+ * two `2 ^ m' the top `sub_bits + 1' bits pick one of `2 ^ sub_bits'.
+ */
+std::size_t histogram_bucket(std::uint64_t value)
+{
+  constexpr std::uint64_t linear = 1ull << (histogram_sub_bits + 1);
+  if (value < linear) {
+    return value;
+  }
+
+  std::uint32_t magnitude = 63 - __builtin_clzll(value);
+  if (magnitude >= histogram_max_bits) {
+    return histogram_buckets - 1;
+  }
+
+  auto const shift = magnitude - histogram_sub_bits;
+  return (std::size_t(shift) << histogram_sub_bits) + (value >> shift);
+}
+
+std::uint64_t histogram_bucket_value(std::size_t bucket)
+{
+  constexpr std::size_t linear = 1u << (histogram_sub_bits + 1);
+  if (bucket < linear) {
+    return bucket;
+  }
+
+  auto const shift = (bucket >> histogram_sub_bits) - 1;
+  auto const top   = bucket - (shift << histogram_sub_bits);
+  return std::uint64_t(top) << shift;
+}
+
+void LatencyHistogram::record(std::uint64_t nanoseconds)
+{
+  buckets[histogram_bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+  auto current = max.load(std::memory_order_relaxed);
+  while (nanoseconds > current
+         && !max.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+  }
+}
+
+std::uint64_t StatsTotals::Timer::percentile(double p) const
+{
+  if (count == 0) {
+    return 0;
+  }
+
+  auto const rank = std::uint64_t(p * (count - 1)) + 1;
+
+  std::uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket != histogram_buckets; ++bucket) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      return bucket == histogram_buckets - 1 ? max : histogram_bucket_value(bucket);
+    }
+  }
+
+  return max;
+}
+
+void StatsTotals::add(Stats const &stats)
+{
+  for (std::size_t i = 0; i != stat_counter_count; ++i) {
+    counters[i] += stats.counters[i].load(std::memory_order_relaxed);
+  }
+
+  for (std::size_t i = 0; i != timer_count; ++i) {
+    auto const &from = stats.timers[i];
+    auto       &to   = timers[i];
+
+    for (std::size_t bucket = 0; bucket != histogram_buckets; ++bucket) {
+      to.buckets[bucket] += from.buckets[bucket].load(std::memory_order_relaxed);
+    }
+
+    to.count += from.count.load(std::memory_order_relaxed);
+    to.sum   += from.sum.load(std::memory_order_relaxed);
+    to.max    = std::max(to.max, from.max.load(std::memory_order_relaxed));
+  }
+}
+
+void StatsTotals::add(StatsTotals const &totals)
+{
+  for (std::size_t i = 0; i != stat_counter_count; ++i) {
+    counters[i] += totals.counters[i];
+  }
+
+  for (std::size_t i = 0; i != timer_count; ++i) {
+    auto const &from = totals.timers[i];
+    auto       &to   = timers[i];
+
+    for (std::size_t bucket = 0; bucket != histogram_buckets; ++bucket) {
+      to.buckets[bucket] += from.buckets[bucket];
+    }
+
+    to.count += from.count;
+    to.sum   += from.sum;
+    to.max    = std::max(to.max, from.max);
+  }
+}
+
+} // namespace ny
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ny {
+
+enum StatsCounter : std::uint32_t
+{
+  stat_process_calls,
+  stat_message_bytes,
+  stat_card_hits,
+  stat_card_misses,
+  stat_script_hits,
+  stat_script_misses,
+  stat_query_calls,
+  stat_counter_count
+};
+
+enum StatsTimer : std::uint32_t
+{
+  timer_process,
+  timer_query_field_card,
+  timer_set_response,
+  timer_count
+};
+
+/**
+ * names as js sees them, `stats()' keys.
+ */
+char const *counter_name(StatsCounter counter);
+char const *timer_name(StatsTimer timer);
+
+/**
+ * latencies in nanoseconds, log-linear buckets (HDR histogram style): 16
+ * per power of two, so any bucket is within ~6% of what fell in it, up to
+ * 2^40 ns (beyond that all land in the last bucket).
+ */
+constexpr std::uint32_t histogram_sub_bits = 4;
+constexpr std::uint32_t histogram_max_bits = 40;
+constexpr std::size_t   histogram_buckets  = (histogram_max_bits - histogram_sub_bits + 1) << histogram_sub_bits;
+
+std::size_t   histogram_bucket(std::uint64_t value);
+std::uint64_t histogram_bucket_value(std::size_t bucket);
+
+struct LatencyHistogram
+{
+  std::atomic<std::uint64_t> buckets[histogram_buckets] = {};
+  std::atomic<std::uint64_t> count = { 0 };
+  std::atomic<std::uint64_t> sum   = { 0 };
+  std::atomic<std::uint64_t> max   = { 0 };
+
+  void record(std::uint64_t nanoseconds);
+};
+
+/**
+ * counters and latencies of a duel, or of an engine. relaxed atomics, a
+ * duel is only touched by one thread at a time (the adds are uncontended)
+ * but may be read from the main thread while a worker steps it.
+ */
+struct Stats
+{
+  std::atomic<std::uint64_t> counters[stat_counter_count] = {};
+  LatencyHistogram           timers[timer_count];
+
+  void count(StatsCounter counter, std::uint64_t n = 1)
+  {
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void time(StatsTimer timer, std::uint64_t nanoseconds)
+  {
+    timers[timer].record(nanoseconds);
+  }
+};
+
+/**
+ * a plain copy of one or more `Stats', added up.
+ */
+struct StatsTotals
+{
+  std::uint64_t counters[stat_counter_count] = {};
+
+  struct Timer
+  {
+    std::uint64_t buckets[histogram_buckets] = {};
+    std::uint64_t count = 0;
+    std::uint64_t sum   = 0;
+    std::uint64_t max   = 0;
+
+    /**
+     * the value below which a fraction `p' (0 to 1) of what was recorded
+     * fell, to bucket precision.
+     */
+    std::uint64_t percentile(double p) const;
+  };
+
+  Timer timers[timer_count];
+
+  void add(Stats const &stats);
+  void add(StatsTotals const &totals);
+};
+
+/**
+ * elapsed time since it was made, in nanoseconds.
+ */
+class Stopwatch
+{
+  using clock = std::chrono::steady_clock;
+
+  clock::time_point start = clock::now();
+
+public:
+  std::uint64_t elapsed() const
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+  }
+};
+
+} // namespace ny
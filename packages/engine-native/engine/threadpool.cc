@@ -0,0 +1,65 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <thread>
+
+namespace ny {
+
+ThreadPool &ThreadPool::shared()
+{
+  static auto pool = new ThreadPool();
+  return *pool;
+}
+
+void ThreadPool::run( void        (*call)(void *, std::size_t)
+                    , void         *fn
+                    , std::size_t   count
+                    , std::uint32_t helpers)
+{
+  auto job = Job { call, fn, count };
+
+  {
+    auto const lock = std::lock_guard<std::mutex>(mutex);
+    for (; n_threads < helpers; ++n_threads) {
+      std::thread(&ThreadPool::work, this).detach();
+    }
+    tickets.insert(tickets.end(), helpers, &job);
+  }
+  wake.notify_all();
+
+  drain(job);
+
+  // tickets nobody took by now are not needed anymore, those taken are
+  // about to find nothing left to do.
+  auto lock = std::unique_lock<std::mutex>(mutex);
+  tickets.erase(std::remove(tickets.begin(), tickets.end(), &job), tickets.end());
+  done.wait(lock, [&] { return job.running == 0; });
+}
+
+void ThreadPool::work()
+{
+  auto lock = std::unique_lock<std::mutex>(mutex);
+  for (;;) {
+    wake.wait(lock, [&] { return !tickets.empty(); });
+
+    auto &job = *tickets.front();
+    tickets.pop_front();
+    ++job.running;
+
+    lock.unlock();
+    drain(job);
+    lock.lock();
+
+    if (--job.running == 0) {
+      done.notify_all();
+    }
+  }
+}
+
+void ThreadPool::drain(Job &job)
+{
+  for (auto i = job.next++; i < job.count; i = job.next++) {
+    job.call(job.fn, i);
+  }
+}
+
+} // namespace ny
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <type_traits>
+
+namespace ny {
+
+/**
+ * threads kept for the lifetime of the process, shared by every engine,
+ * so `stepMany' and friends do not start and join threads on each call.
+ *
+ * several `parallel_for's may run at once (the main thread and libuv's
+ * pool both call in), they share the threads. a caller always works on
+ * its own job too, so it never waits on a pool busy with someone else's.
+ */
+class ThreadPool
+{
+  struct Job
+  {
+    void          (*call)(void *, std::size_t);
+    void           *fn;
+    std::size_t     count;
+    std::atomic<std::size_t> next { 0 };
+
+    /**
+     * pool threads working on the job, guarded by `mutex'.
+     */
+    std::uint32_t   running = 0;
+  };
+
+  std::mutex              mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+
+  /**
+   * one entry per pool thread a job asked for, taken in order.
+   */
+  std::deque<Job *>       tickets;
+  std::uint32_t           n_threads = 0;
+
+public:
+  /**
+   * never destroyed, its threads are detached.
+   */
+  static ThreadPool &shared();
+
+  /**
+   * calls `fn(i)' for every `i' in `[0, count)', spread over up to
+   * `threads' threads (the calling one included), each taking the next
+   * index as it gets done with one.
+   */
+  template <typename Fn>
+  void parallel_for(std::size_t count, std::uint32_t threads, Fn &&fn)
+  {
+    threads = static_cast<std::uint32_t>(std::min<std::size_t>(threads, count));
+    if (threads <= 1) {
+      for (std::size_t i = 0; i != count; ++i) {
+        fn(i);
+      }
+      return;
+    }
+
+    auto call = [](void *fn, std::size_t i) { (*static_cast<std::remove_reference_t<Fn> *>(fn))(i); };
+    run(call, &fn, count, threads - 1);
+  }
+
+private:
+  ThreadPool() = default;
+
+  void run( void        (*call)(void *, std::size_t)
+          , void         *fn
+          , std::size_t   count
+          , std::uint32_t helpers);
+
+  void work();
+
+  static void drain(Job &job);
+};
+
+} // namespace ny
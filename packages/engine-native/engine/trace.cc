@@ -0,0 +1,179 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ny {
+
+char const *trace_name(TraceKind kind)
+{
+  static char const *names[trace_kind_count] = { "process"
+                                               , "queryCard"
+                                               , "queryFieldCount"
+                                               , "queryFieldCard"
+                                               , "setResponse"
+                                               , "script"
+                                               , "card" };
+
+  return kind < trace_kind_count ? names[kind] : "?";
+}
+
+std::uint64_t trace_now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceBuffer::TraceBuffer(std::size_t capacity)
+  : events(capacity ? capacity : 1)
+{
+}
+
+void TraceBuffer::add( TraceKind     kind
+                     , std::uint64_t begin
+                     , std::uint64_t end
+                     , std::uint32_t arg
+                     , char const   *label)
+{
+  auto &event = events[written++ % events.size()];
+  event.begin = begin;
+  event.end   = end;
+  event.arg   = arg;
+  event.kind  = kind;
+
+  auto const length = label ? strnlen(label, trace_label_size - 1) : 0;
+  if (length) {
+    std::memcpy(event.label, label, length);
+  }
+  event.label[length] = 0;
+}
+
+std::uint64_t TraceBuffer::overwritten() const
+{
+  return written > events.size() ? written - events.size() : 0;
+}
+
+static
+void append_escaped(std::string &json, char const *text)
+{
+  for (; *text; ++text) {
+    auto const c = static_cast<unsigned char>(*text);
+    if (c == '"' || c == '\\') {
+      json += '\\';
+      json += char(c);
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof escaped, "\\u%04x", c);
+      json += escaped;
+    } else {
+      json += char(c);
+    }
+  }
+}
+
+void TraceBuffer::append_json(std::string &json, std::uint32_t pid, std::uint32_t tid, bool &first) const
+{
+  auto const count = written < events.size() ? written : events.size();
+
+  for (auto at = written - count; at != written; ++at) {
+    auto const &event = events[at % events.size()];
+
+    char head[192];
+    std::snprintf( head
+                 , sizeof head
+                 , "%s{\"name\":\"%s\",\"cat\":\"ocgcore\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u"
+                   ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{"
+                 , first ? "" : ","
+                 , trace_name(event.kind)
+                 , pid
+                 , tid
+                 , event.begin / 1e3
+                 , (event.end - event.begin) / 1e3);
+    json += head;
+    first = false;
+
+    if (event.kind == trace_script) {
+      json += "\"name\":\"";
+      append_escaped(json, event.label);
+      json += "\"}}";
+    } else {
+      char tail[32];
+      std::snprintf(tail, sizeof tail, "\"arg\":%u}}", event.arg);
+      json += tail;
+    }
+  }
+}
+
+/**
+ * opened once and never closed: spans running on worker threads may be
+ * about to write to it whenever markers are turned off, a closed (and
+ * reused) fd would send their lines elsewhere.
+ */
+static std::atomic<int>  marker_fd      = { -1 };
+static std::atomic<bool> marker_enabled = { false };
+
+bool enable_trace_markers()
+{
+  if (marker_fd.load() < 0) {
+    for (auto path: { "/sys/kernel/tracing/trace_marker", "/sys/kernel/debug/tracing/trace_marker" }) {
+      auto const fd = ::open(path, O_WRONLY | O_CLOEXEC);
+      if (fd >= 0) {
+        auto expected = -1;
+        if (!marker_fd.compare_exchange_strong(expected, fd)) {
+          ::close(fd);
+        }
+        break;
+      }
+    }
+  }
+
+  if (marker_fd.load() < 0) {
+    return false;
+  }
+
+  marker_enabled = true;
+  return true;
+}
+
+void disable_trace_markers()
+{
+  marker_enabled = false;
+}
+
+void TraceSpan::open()
+{
+  auto const fd = marker_fd.load(std::memory_order_relaxed);
+  if (fd >= 0 && marker_enabled.load(std::memory_order_relaxed)) {
+    marked = true;
+
+    char line[96];
+    auto const length = kind == trace_script && label
+      ? std::snprintf(line, sizeof line, "B|%d|script %.*s", int(::getpid()), int(trace_label_size - 1), label)
+      : arg
+      ? std::snprintf(line, sizeof line, "B|%d|%s %u", int(::getpid()), trace_name(kind), arg)
+      : std::snprintf(line, sizeof line, "B|%d|%s", int(::getpid()), trace_name(kind));
+    [[maybe_unused]] auto const ignored = ::write(fd, line, std::min<std::size_t>(length, sizeof line - 1));
+  }
+
+  begin = trace_now();
+}
+
+void TraceSpan::close()
+{
+  auto const end = trace_now();
+  buffer->add(kind, begin, end, arg, label);
+
+  /* the fd stays valid once a span got to write to it. */
+  if (marked) {
+    auto const fd = marker_fd.load(std::memory_order_relaxed);
+    char line[32];
+    auto const length = std::snprintf(line, sizeof line, "E|%d", int(::getpid()));
+    [[maybe_unused]] auto const ignored = ::write(fd, line, length);
+  }
+}
+
+} // namespace ny
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ny {
+
+enum TraceKind : std::uint8_t
+{
+  trace_process,            // arg: message bytes
+  trace_query_card,         // arg: location
+  trace_query_field_count,  // arg: location
+  trace_query_field_card,   // arg: location
+  trace_set_response,       // arg: response length
+  trace_script,             // label: script name
+  trace_card,               // arg: card code
+
+  trace_kind_count
+};
+
+char const *trace_name(TraceKind kind);
+
+constexpr std::size_t trace_label_size = 43;
+
+/**
+ * one span, steady clock nanoseconds.
+ */
+struct TraceEvent
+{
+  std::uint64_t begin;
+  std::uint64_t end;
+  std::uint32_t arg;
+  TraceKind     kind;
+  char          label[trace_label_size];
+};
+
+static_assert(sizeof(TraceEvent) == 64, "TraceEvent layout changed");
+
+/**
+ * a duel's spans, the last `capacity' of them. allocated once, written by
+ * whoever steps the duel, read only while no one does.
+ */
+class TraceBuffer
+{
+  std::vector<TraceEvent> events;
+  std::uint64_t           written = 0;
+
+public:
+  explicit TraceBuffer(std::size_t capacity);
+
+  void add( TraceKind     kind
+          , std::uint64_t begin
+          , std::uint64_t end
+          , std::uint32_t arg
+          , char const   *label);
+
+  /**
+   * spans pushed out by newer ones.
+   */
+  std::uint64_t overwritten() const;
+
+  /**
+   * appends the spans, oldest first, as chrome trace events (`ph: X') of
+   * thread `tid' of process `pid', each preceded by a comma unless `first'.
+   */
+  void append_json(std::string &json, std::uint32_t pid, std::uint32_t tid, bool &first) const;
+};
+
+/**
+ * systrace style `B|pid|name' / `E|pid' lines written to ftrace's
+ * `trace_marker' while a span is open, for `perf record -e ftrace:print'
+ * (or perfetto) to line spans up with samples. off until enabled, false if
+ * `trace_marker' can not be opened.
+ */
+bool enable_trace_markers();
+void disable_trace_markers();
+
+std::uint64_t trace_now();
+
+/**
+ * records a span into `buffer' when it goes out of scope, costs a null
+ * check when `buffer' is null (tracing off).
+ */
+class TraceSpan
+{
+  TraceBuffer   *buffer;
+  TraceKind      kind;
+  char const    *label;
+  std::uint64_t  begin  = 0;
+  bool           marked = false;
+
+public:
+  std::uint32_t  arg;
+
+  TraceSpan(TraceBuffer *buffer, TraceKind kind, std::uint32_t arg = 0, char const *label = nullptr)
+    : buffer(buffer)
+    , kind(kind)
+    , label(label)
+    , arg(arg)
+  {
+    if (buffer) {
+      open();
+    }
+  }
+
+  ~TraceSpan()
+  {
+    if (buffer) {
+      close();
+    }
+  }
+
+  TraceSpan(TraceSpan const &) = delete;
+  TraceSpan &operator =(TraceSpan const &) = delete;
+
+private:
+  void open();
+  void close();
+};
+
+} // namespace ny
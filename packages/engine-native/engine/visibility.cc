@@ -0,0 +1,258 @@
+#include "visibility.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ny {
+
+void MessageViews::clear()
+{
+  for (std::size_t view = 0; view != view_count; ++view) {
+    messages[view].clear();
+    frames[view].clear();
+  }
+}
+
+namespace {
+
+constexpr std::uint8_t location_deck    = 0x01;
+constexpr std::uint8_t location_hand    = 0x02;
+constexpr std::uint8_t location_grave   = 0x10;
+constexpr std::uint8_t location_extra   = 0x40;
+constexpr std::uint8_t location_overlay = 0x80;
+
+constexpr std::uint8_t position_faceup   = 0x05;
+constexpr std::uint8_t position_facedown = 0x0A;
+
+constexpr std::uint32_t query_code     = 0x1;
+constexpr std::uint32_t query_position = 0x2;
+
+/** drawn face up, `MSG_DRAW' sets it on a code. */
+constexpr std::uint32_t code_public = 0x80000000u;
+
+bool sees(std::size_t view, std::uint8_t recipient)
+{
+  if (recipient == recipient_all) {
+    return true;
+  }
+
+  if (recipient & recipient_except) {
+    return view != (recipient & ~recipient_except);
+  }
+
+  return view == recipient;
+}
+
+std::uint32_t u32_at(unsigned char const *at)
+{
+  std::uint32_t value;
+  std::memcpy(&value, at, sizeof value);
+  return value;
+}
+
+void zero_code(unsigned char *at)
+{
+  std::memset(at, 0, 4);
+}
+
+/**
+ * zeroes `count' codes from `at' (bounded by `end'), those drawn face up
+ * too unless `keep_public'.
+ */
+void zero_codes( unsigned char *at
+               , unsigned char *end
+               , std::size_t    count
+               , bool           keep_public)
+{
+  for (std::size_t i = 0; i != count && end - at >= 4; ++i, at += 4) {
+    if (!keep_public || !(u32_at(at) & code_public)) {
+      zero_code(at);
+    }
+  }
+}
+
+/**
+ * copies query chunks (`[u32 length][u32 flags][fields...]') to `out',
+ * those of cards a non-controller can not see cut down to their position.
+ */
+void hide_chunks( unsigned char const        *chunks
+                , std::size_t                 length
+                , std::uint8_t                location
+                , std::vector<unsigned char> &out)
+{
+  auto read = chunks;
+  auto end  = chunks + length;
+
+  while (end - read >= 4) {
+    auto chunk_length = u32_at(read);
+    if (chunk_length < 4 || chunk_length > std::size_t(end - read)) {
+      chunk_length = end - read;
+    }
+
+    auto const chunk = read;
+    read += chunk_length;
+
+    if (chunk_length < 8 || (location & (location_grave | location_overlay))) {
+      out.insert(out.end(), chunk, chunk + chunk_length);
+      continue;
+    }
+
+    auto const flags           = u32_at(chunk + 4);
+    auto const position_offset = std::uint32_t(flags & query_code ? 12 : 8);
+    auto const has_position    = (flags & query_position) && position_offset + 4 <= chunk_length;
+    auto const position        = has_position ? chunk[position_offset + 3] : 0;
+
+    auto const hidden_location = location & (location_deck | location_hand | location_extra);
+    auto const hidden          = has_position ? !(position & position_faceup) : hidden_location != 0;
+
+    if (!hidden) {
+      out.insert(out.end(), chunk, chunk + chunk_length);
+      continue;
+    }
+
+    std::uint32_t const hidden_flags  = has_position ? query_position : 0;
+    std::uint32_t const hidden_length = has_position ? 12 : 8;
+
+    auto const at = out.size();
+    out.resize(at + hidden_length);
+    std::memcpy(out.data() + at,     &hidden_length, 4);
+    std::memcpy(out.data() + at + 4, &hidden_flags,  4);
+    if (has_position) {
+      std::memcpy(out.data() + at + 8, chunk + position_offset, 4);
+    }
+  }
+}
+
+/**
+ * the player who sees a message as it is, if it has anything to hide from
+ * the others. `recipient_all' if it has not.
+ */
+std::uint8_t owner_of(unsigned char const *message, std::size_t length)
+{
+  auto const at = [&](std::size_t offset) -> std::uint8_t {
+    return offset < length ? message[offset] : 0;
+  };
+
+  switch (message[0]) {
+    case MSG_DRAW:
+    case MSG_SHUFFLE_HAND:
+    case MSG_SHUFFLE_EXTRA:
+    case MSG_UPDATE_DATA:
+    case MSG_UPDATE_CARD:
+      return at(1);
+
+    case MSG_MOVE: {
+      auto const location = at(10);
+      auto const position = at(12);
+      if (location & (location_grave | location_overlay)) {
+        return recipient_all;
+      }
+      if ((location & (location_deck | location_hand)) || (position & position_facedown)) {
+        return at(9);
+      }
+      return recipient_all;
+    }
+
+    case MSG_SET:
+      /* hidden from everyone, the owner included. */
+      return recipient_except;
+
+    default:
+      return recipient_all;
+  }
+}
+
+/**
+ * appends `message' as `view' (not its owner) gets to see it.
+ */
+void append_hidden( unsigned char const        *message
+                  , std::size_t                 length
+                  , std::vector<unsigned char> &out)
+{
+  auto const at = out.size();
+
+  switch (message[0]) {
+    case MSG_UPDATE_DATA:
+      out.insert(out.end(), message, message + std::min<std::size_t>(3, length));
+      if (length > 3) {
+        hide_chunks(message + 3, length - 3, message[2], out);
+      }
+      return;
+
+    case MSG_UPDATE_CARD:
+      out.insert(out.end(), message, message + std::min<std::size_t>(4, length));
+      if (length > 4) {
+        hide_chunks(message + 4, length - 4, message[2], out);
+      }
+      return;
+
+    default:
+      break;
+  }
+
+  out.insert(out.end(), message, message + length);
+
+  auto const copy = out.data() + at;
+  auto const end  = copy + length;
+
+  switch (message[0]) {
+    case MSG_DRAW:
+      if (length >= 3) {
+        zero_codes(copy + 3, end, copy[2], true);
+      }
+      break;
+
+    case MSG_SHUFFLE_HAND:
+    case MSG_SHUFFLE_EXTRA:
+      if (length >= 3) {
+        zero_codes(copy + 3, end, copy[2], false);
+      }
+      break;
+
+    case MSG_MOVE:
+    case MSG_SET:
+      if (length >= 5) {
+        zero_code(copy + 1);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+} // namespace
+
+void split_views( unsigned char const *data
+                , MessageFrame const  *frames
+                , std::size_t          n_frames
+                , MessageViews        &views)
+{
+  for (std::size_t i = 0; i != n_frames; ++i) {
+    auto const &frame   = frames[i];
+    auto const  message = data + frame.offset;
+    auto const  owner   = frame.length ? owner_of(message, frame.length) : recipient_all;
+
+    for (std::size_t view = 0; view != view_count; ++view) {
+      if (!sees(view, frame.recipient)) {
+        continue;
+      }
+
+      auto &out = views.messages[view];
+      auto const offset = out.size();
+
+      if (owner == recipient_all || owner == view || frame.length == 0) {
+        out.insert(out.end(), message, message + frame.length);
+      } else {
+        append_hidden(message, frame.length, out);
+      }
+
+      views.frames[view].push_back(MessageFrame { std::uint32_t(offset)
+                                                , std::uint32_t(out.size() - offset)
+                                                , frame.type
+                                                , frame.recipient
+                                                , 0 });
+    }
+  }
+}
+
+} // namespace ny
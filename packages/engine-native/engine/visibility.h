@@ -0,0 +1,52 @@
+#pragma once
+
+#include "messages.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ny {
+
+/**
+ * who looks at a duel: either player, or a spectator.
+ */
+constexpr std::size_t view_count     = 3;
+constexpr std::size_t view_spectator = 2;
+
+/**
+ * what each view gets of a buffer of framed messages, back to back, with
+ * frames of their own (offsets into `messages[view]').
+ */
+struct MessageViews
+{
+  std::vector<unsigned char> messages[view_count];
+  std::vector<MessageFrame>  frames[view_count];
+
+  void clear();
+};
+
+/**
+ * one pass over `frames' (messages in `data', see `frame_messages'),
+ * appending each message to the views it is meant for (its recipient),
+ * with what a view must not see taken out, as ygopro's SingleDuel::Analyze
+ * does it:
+ *
+ *   - MSG_DRAW: codes not drawn face up, for all but the drawing player
+ *   - MSG_SHUFFLE_HAND / MSG_SHUFFLE_EXTRA: codes, for all but the owner
+ *   - MSG_MOVE: the code, for all but the new controller, when the card
+ *     ends up in the deck or hand, or face down (graves and overlays are
+ *     public)
+ *   - MSG_SET: the code, for everyone
+ *   - MSG_UPDATE_DATA / MSG_UPDATE_CARD: cards not face up (outside of the
+ *     grave), for all but the controller. their chunk is cut down to the
+ *     position (what @ego/message-protocol can still parse), where ygopro
+ *     zeroes it whole.
+ *
+ * codes are zeroed in place, so those messages keep their layout.
+ */
+void split_views( unsigned char const *data
+                , MessageFrame const  *frames
+                , std::size_t          n_frames
+                , MessageViews        &views);
+
+} // namespace ny
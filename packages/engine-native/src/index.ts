@@ -1,5 +1,5 @@
 // import engine from '../build/Release/enginewrapper.node'
-import { DataStore, ScriptStore, CoreEngine } from '@ego/engine-interface'
+import { DataStore, ScriptStore, CoreEngine, ReplayFile } from '@ego/engine-interface'
 
 let engine: any
 
@@ -16,5 +16,6 @@ try {
 const DataStore: new() => DataStore = engine.DataStore
 const ScriptStore: new() => ScriptStore = engine.ScriptStore
 const CoreEngine: new(sharedObjectPath: string) => CoreEngine = engine.CoreEngine
+const readReplay: (content: ArrayBuffer | ArrayBufferView) => ReplayFile = engine.readReplay
 
-export { DataStore, ScriptStore, CoreEngine }
+export { DataStore, ScriptStore, CoreEngine, readReplay }
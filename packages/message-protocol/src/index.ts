@@ -3107,6 +3107,53 @@ export function parseMessage(from: BufferLike): Message[] {
   return messages;
 }
 
+/**
+ * one entry of a message index built by engine-native
+ * (`runUntilDecision', `indexMessages')
+ */
+export interface MessageFrame {
+  offset: number;
+  length: number;
+  type: number;
+  recipient: number;
+}
+
+export const MESSAGE_FRAME_SIZE = 12;
+
+/**
+ * `MessageFrame.recipient': a player (0 / 1), everyone but a player
+ * (`RECIPIENT.EXCEPT | player'), or everyone
+ */
+export const RECIPIENT = {
+  EXCEPT: 0x80,
+  ALL: 0xFF,
+};
+
+/**
+ * read a native message index, its first `count' frames if given
+ */
+export function readMessageFrames(index: ArrayBuffer, count?: number): MessageFrame[] {
+  const view = new DataView(index);
+  const frames: MessageFrame[] = [];
+  const end = count === undefined ? index.byteLength : Math.min(index.byteLength, count * MESSAGE_FRAME_SIZE);
+  for (let off = 0; off + MESSAGE_FRAME_SIZE <= end; off += MESSAGE_FRAME_SIZE) {
+    frames.push({
+      offset: view.getUint32(off, true),
+      length: view.getUint32(off + 4, true),
+      type: view.getUint8(off + 8),
+      recipient: view.getUint8(off + 9),
+    });
+  }
+  return frames;
+}
+
+/**
+ * parse only the message `frame' points at
+ */
+export function parseFramedMessage(from: BufferLike, frame: MessageFrame): Message {
+  return parseOneMessage(new BufferReader(from, frame.offset));
+}
+
 export const OPERATION = {
   SUCCESS: 0x000000000001,
   FAIL: 0x000000000000,
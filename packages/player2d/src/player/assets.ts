@@ -34,12 +34,14 @@ export async function loadAssets(
   const database = await request('GET', 'assets/database.json')
     .then(o => JSON.parse(o) as CardRecordWithText[])
 
-  const marks: Set<number> = new Set()
+  const marks: Set<number> = new Set(replay.codes)
 
-  extractCodelike(replay.messages, marks)
-  for (const p of replay.players) {
-    extractCodelike({ cards: p.main }, marks)
-    extractCodelike({ cards: p.extra }, marks)
+  if (!replay.codes) {
+    extractCodelike(replay.messages, marks)
+    for (const p of replay.players) {
+      extractCodelike({ cards: p.main }, marks)
+      extractCodelike({ cards: p.extra }, marks)
+    }
   }
 
   const total    = marks.size + 2
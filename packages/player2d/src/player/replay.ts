@@ -7,5 +7,7 @@ export interface LaminatedReplay {
     extra: number[]
   }>
   messages: Message[]
+  // card codes the replay refers to, older laminates do not have them.
+  codes?: number[]
 }
 
@@ -1,12 +1,11 @@
-import { CardRecordWithText } from '@ego/common'
-import { loadFromSqliteDB, parseReplay, ReplayReader } from '@ego/data-loader'
+import { parseReplay, ReplayReader } from '@ego/data-loader'
 import { DuelDriver, isHostAwaitingResponse } from '@ego/duel-host'
-import { CoreEngine } from '@ego/engine-interface'
-import { CoreEngine as Engine, DataStore, ScriptStore } from '@ego/engine-native'
-import { Message } from '@ego/message-protocol'
-import { lstat, readdir, readFile, writeFile } from 'fs-extra'
+import { CoreEngine, readReplayVerdicts, REPLAY_OUTCOME, ReplayInput } from '@ego/engine-interface'
+import { CoreEngine as Engine, DataStore, readReplay, ScriptStore } from '@ego/engine-native'
+import { lstat, readdir, readFile } from 'fs-extra'
 import { join, parse } from 'path'
 import yargs from 'yargs'
+import { LaminateFormat, LaminateSink } from './sink'
 
 function extractCodelike(m: any, marks: Set<number>) {
   function walk(o: any, key: string) {
@@ -24,8 +23,21 @@ function extractCodelike(m: any, marks: Set<number>) {
   walk(m, '')
 }
 
-type Database = Record<number, CardRecordWithText>
-export function laminate(core: CoreEngine, data: Buffer) {
+/**
+ * plays a replay through, every message goes to `sink' as soon as it comes
+ * out, card codes are collected along the way. on failure what was written
+ * is dropped (see `LaminateSink.abort').
+ */
+export async function laminate(core: CoreEngine, data: Buffer, sink: LaminateSink) {
+  try {
+    return await play(core, data, sink)
+  } catch (e) {
+    await sink.abort()
+    throw e
+  }
+}
+
+async function play(core: CoreEngine, data: Buffer, sink: LaminateSink) {
   const reader = new ReplayReader(parseReplay(data))
   const responses = reader.responses()
   const duel = new DuelDriver(core, {
@@ -37,7 +49,13 @@ export function laminate(core: CoreEngine, data: Buffer) {
     engineOptions: reader.replay.options
   })
 
-  const messages: Message[] = []
+  const marks: Set<number> = new Set()
+  for (const p of reader.replay.players) {
+    extractCodelike({ cards: p.main }, marks)
+    extractCodelike({ cards: p.extra }, marks)
+  }
+
+  if (!sink.begin(reader.replay.players)) { await sink.drain() }
 
   let next = 0
   try {
@@ -47,7 +65,8 @@ export function laminate(core: CoreEngine, data: Buffer) {
       for (const step of steps) {
         if (step.tag === 'HOST_ERROR') { throw step.what }
         if (step.tag === 'HOST_DUEL_FINISHED') { break retry }
-        messages.push(step.what)
+        extractCodelike(step.what, marks)
+        if (!sink.message(step.what)) { await sink.drain() }
 
         if (isHostAwaitingResponse(step)) {
           if (next >= responses.length) {
@@ -68,14 +87,64 @@ export function laminate(core: CoreEngine, data: Buffer) {
     duel.release()
   }
 
-  const marks: Set<number> = new Set()
-  extractCodelike(messages, marks)
-  for (const p of reader.replay.players) {
-    extractCodelike({ cards: p.main }, marks)
-    extractCodelike({ cards: p.extra }, marks)
+  const codes = [...marks.values()]
+  await sink.end(codes)
+
+  return { players: reader.replay.players, codes }
+}
+
+function replayInput(data: Buffer): ReplayInput {
+  const replay = readReplay(data)
+  if (replay.players.length !== 2) {
+    throw new Error('TAG replay not supported')
   }
 
-  return { players: reader.replay.players, messages }
+  return replay
+}
+
+const OUTCOME_NAMES = Object.keys(REPLAY_OUTCOME)
+
+/**
+ * replays handed to `verifyReplaysAsync' at once, per thread. only a chunk
+ * is read and decoded at a time, however large the corpus.
+ */
+const VERIFY_CHUNK_PER_THREAD = 64
+
+/**
+ * plays every replay through natively, `threads' at a time, no messages
+ * are kept. returns the number of replays that did not check out.
+ */
+export async function verify(core: CoreEngine, replays: string[], threads: number) {
+  const chunkSize = Math.max(1, threads) * VERIFY_CHUNK_PER_THREAD
+  let failures = 0
+
+  for (let from = 0; from < replays.length; from += chunkSize) {
+    const names: string[] = []
+    const inputs: ReplayInput[] = []
+
+    for (const replay of replays.slice(from, from + chunkSize)) {
+      try {
+        inputs.push(replayInput(await readFile(replay)))
+        names.push(replay)
+      } catch (e) {
+        console.error(`[verify] ${replay}: ${e}`)
+        ++failures
+      }
+    }
+
+    if (!inputs.length) { continue }
+
+    const verdicts = readReplayVerdicts(await core.verifyReplaysAsync(inputs, threads))
+    verdicts.forEach((verdict, i) => {
+      const ok = verdict.outcome === REPLAY_OUTCOME.FINISHED || verdict.outcome === REPLAY_OUTCOME.EXHAUSTED
+      const retry = verdict.retryAt === undefined ? '' : `, retry at response #${verdict.retryAt}`
+      const line = `[verify] ${names[i]}: ${OUTCOME_NAMES[verdict.outcome]}`
+        + ` (${verdict.consumed}/${verdict.total} responses, ${verdict.steps} steps${retry})`
+      if (ok) { console.log(line) } else { console.error(line); ++failures }
+    })
+  }
+
+  return failures
 }
 
 yargs.command(
@@ -84,8 +153,11 @@ yargs.command(
   y => y
     .option('engine', { type: 'string', alias: 'e', demandOption: true, desc: 'path of libocgcore.so' })
     .option('database', { type: 'string', alias: 'd', demandOption: true, desc: 'path of cards.cdb' })
-    .option('scripts', { type: 'string', alias: 's', demandOption: true, desc: 'directory of card scripts' })
-    .option('outdir', { type: 'string', demandOption: true, desc: 'output directory' })
+    .option('scripts', { type: 'string', alias: 's', demandOption: true, desc: 'directory of card scripts, or a script archive' })
+    .option('outdir', { type: 'string', desc: 'output directory' })
+    .option('format', { choices: ['json', 'ndjson'], default: 'json', desc: 'output format' })
+    .option('verify', { type: 'boolean', default: false, desc: 'only check that replays play through, natively' })
+    .option('threads', { type: 'number', default: 1, desc: 'threads to verify replays on' })
     .option('batch', { type: 'array', demandOption: true, desc: 'input files' })
     .positional('replays', { alias: 'batch' }),
   async args => {
@@ -94,41 +166,57 @@ yargs.command(
     const engine = new Engine(args.engine)
 
     const dataStore = new DataStore()
-    const db: Database = {}
 
     console.log(`[init-engine] opening database: ${args.database}`)
-    const records = await loadFromSqliteDB(args.database)
-    for (const record of records) {
-      dataStore.add(record)
-      db[record.code] = record
-      console.log(`[init-engine] add data store: ${record.name}...`)
-    }
-    console.log(`[init-engine] loaded ${records.length} records.`)
+    const count = dataStore.loadCdb(args.database)
+    console.log(`[init-engine] loaded ${count} records.`)
+    dataStore.freeze()
 
     const scriptStore = new ScriptStore()
 
     console.log(`[init-engine] loading scripts from: ${args.scripts}`)
-    const files = await readdir(args.scripts)
-    for (const file of files) {
-      const path = join(args.scripts, file)
-      const stat = await lstat(path)
-      if (!stat.isFile()) { continue }
-      const content = await readFile(path)
-      scriptStore.add(file, content.toString())
+    if ((await lstat(args.scripts)).isFile()) {
+      const count = scriptStore.loadArchive(args.scripts)
+      console.log(`[init-engine] mapped ${count} scripts.`)
+    } else {
+      const files = await readdir(args.scripts)
+      for (const file of files) {
+        const path = join(args.scripts, file)
+        const stat = await lstat(path)
+        if (!stat.isFile()) { continue }
+        const content = await readFile(path)
+        scriptStore.add(file, content.toString())
+      }
+
+      console.log(`[init-engine] loaded ${files.length} scripts.`)
     }
 
-    console.log(`[init-engine] loaded ${files.length} scripts.`)
+    scriptStore.freeze()
 
     engine.bindData(dataStore)
     engine.bindScript(scriptStore)
 
-    for (const replay of args.batch.concat(args._) as string[]) {
+    const replays = args.batch.concat(args._) as string[]
+
+    if (args.verify) {
+      const failures = await verify(engine, replays, args.threads)
+      console.log(`[verify] ${replays.length - failures}/${replays.length} replays ok.`)
+      process.exitCode = failures ? 1 : 0
+      return
+    }
+
+    if (!args.outdir) {
+      throw new Error('--outdir is required unless --verify is given')
+    }
+
+    for (const replay of replays) {
       const name = parse(replay).name
-      const output = join(args.outdir, `${name}.laminated.json`)
+      const format = args.format as LaminateFormat
+      const output = join(args.outdir, `${name}.laminated.${format}`)
       console.log(`[laminate] ${replay}...`)
+      const sink = new LaminateSink(output, format)
       try {
-        const data = laminate(engine, await readFile(replay))
-        await writeFile(output, JSON.stringify(data, undefined, 0))
+        await laminate(engine, await readFile(replay), sink)
         console.log(`[laminate] ${replay} done.`)
       } catch (e) {
         console.error(e)
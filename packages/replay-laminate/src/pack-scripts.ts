@@ -0,0 +1,38 @@
+import { ScriptStore } from '@ego/engine-native'
+import { execFileSync } from 'child_process'
+import { lstat, readdir, readFile } from 'fs-extra'
+import { join } from 'path'
+import * as Y from 'yargs'
+
+// luac writes the chunk to stdout with `-o -`.
+function compile(luac: string, path: string): Buffer {
+  return execFileSync(luac, ['-o', '-', path], { maxBuffer: 64 * 1024 * 1024 })
+}
+
+Y.command(
+  '$0 [scripts]',
+  'pack a script directory into a script archive',
+  y => y
+    .positional('scripts', { type: 'string', demandOption: true, desc: 'directory of card scripts' })
+    .option('output', { type: 'string', alias: 'o', demandOption: true, desc: 'path of the archive' })
+    .option('luac', { type: 'string', desc: 'precompile with this luac (must match the lua of libocgcore.so)' })
+    .option('source', { type: 'boolean', default: true, desc: 'keep lua sources (--no-source: bytecode only)' }),
+  async args => {
+    const scriptStore = new ScriptStore()
+    const files = await readdir(args.scripts)
+    for (const file of files) {
+      const path = join(args.scripts, file)
+      const stat = await lstat(path)
+      if (!stat.isFile()) { continue }
+      if (args.source || !args.luac) {
+        const content = await readFile(path)
+        scriptStore.add(file, content.toString())
+      }
+      if (args.luac && file.endsWith('.lua')) {
+        scriptStore.addCompiled(file, compile(args.luac, path))
+      }
+    }
+
+    scriptStore.saveArchive(args.output)
+    console.log(`[pack-scripts] packed ${files.length} scripts into ${args.output}.`)
+  }).parse(process.argv)
@@ -0,0 +1,86 @@
+import { Message } from '@ego/message-protocol'
+import { createWriteStream, WriteStream } from 'fs'
+import { remove } from 'fs-extra'
+
+export type LaminateFormat = 'json' | 'ndjson'
+
+export interface LaminatedPlayer {
+  name: string
+  main: number[]
+  extra: number[]
+}
+
+/**
+ * writes a laminated replay as it is produced, nothing is held on to.
+ *
+ * json:   `{"players":[...],"messages":[...],"codes":[...]}`, what player2d
+ *         loads.
+ * ndjson: `{"players":[...]}`, one message per line, then `{"codes":[...]}`.
+ *
+ * `begin' / `message' return false once the stream is backed up, wait on
+ * `drain' before writing more.
+ *
+ * a failed stream (the file can not be created, the disk is full, ...)
+ * makes every later call throw (or reject) with its error.
+ */
+export class LaminateSink {
+  private stream: WriteStream
+  private count = 0
+  private error?: Error
+
+  constructor(readonly path: string, readonly format: LaminateFormat) {
+    this.stream = createWriteStream(path)
+    this.stream.on('error', error => { this.error = this.error || error })
+  }
+
+  begin(players: LaminatedPlayer[]): boolean {
+    return this.format === 'json'
+      ? this.write(`{"players":${JSON.stringify(players)},"messages":[`)
+      : this.write(`${JSON.stringify({ players })}\n`)
+  }
+
+  message(m: Message): boolean {
+    const json = JSON.stringify(m)
+    return this.format === 'json'
+      ? this.write(this.count++ ? `,${json}` : json)
+      : this.write(`${json}\n`)
+  }
+
+  drain(): Promise<void> {
+    return this.settle(done => this.stream.once('drain', done))
+  }
+
+  end(codes: number[]): Promise<void> {
+    const tail = this.format === 'json'
+      ? `],"codes":${JSON.stringify(codes)}}`
+      : `${JSON.stringify({ codes })}\n`
+
+    return this.settle(done => this.stream.end(tail, () => done()))
+  }
+
+  private write(chunk: string): boolean {
+    if (this.error) { throw this.error }
+    return this.stream.write(chunk)
+  }
+
+  // resolves once `start' calls back, rejects as soon as the stream fails.
+  private settle(start: (done: () => void) => void): Promise<void> {
+    return new Promise((resolve, reject) => {
+      if (this.error) { return reject(this.error) }
+      const onError = (error: Error) => reject(error)
+      this.stream.once('error', onError)
+      start(() => {
+        this.stream.off('error', onError)
+        resolve()
+      })
+    })
+  }
+
+  /**
+   * drops what was written so far.
+   */
+  async abort() {
+    this.stream.destroy()
+    await remove(this.path)
+  }
+}